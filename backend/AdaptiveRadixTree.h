@@ -0,0 +1,589 @@
+#ifndef ADAPTIVERADIXTREE_H
+#define ADAPTIVERADIXTREE_H
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <ostream>
+#include <type_traits>
+#include <vector>
+#include "NodePool.h"
+#include "Serialize.h"
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Adaptive radix tree nodes (Leis et al., ICDE 2013). An inner node branches on one key byte and
+// comes in four sizes that a node grows through as children are added: 4 and 16 children keep a
+// sorted byte array next to the child pointers, 48 keeps a 256-entry byte -> slot table, 256 is
+// indexed by the byte directly. Inner nodes also skip the bytes all keys below them share (path
+// compression), and a key with no sibling sits in a leaf as high up as it can (lazy expansion).
+enum ArtNodeType : uint8_t { ART_LEAF, ART_NODE4, ART_NODE16, ART_NODE48, ART_NODE256 };
+
+struct ArtHeader {
+    uint8_t type;
+    uint8_t prefixLen = 0; // key bytes this node skips, all of them kept in prefix
+    uint16_t count = 0;    // children in use
+    uint8_t prefix[8];
+
+    explicit ArtHeader(uint8_t type) : type(type) {}
+};
+
+template <typename Value>
+struct ArtLeaf {
+    ArtHeader h{ART_LEAF};
+    uint64_t bits; // the key, encoded so byte order is key order
+    Value value;
+
+    ArtLeaf(uint64_t bits, const Value& value) : bits(bits), value(value) {}
+};
+
+struct ArtNode4 {
+    ArtHeader h{ART_NODE4};
+    uint8_t keys[4];
+    ArtHeader* children[4];
+};
+struct ArtNode16 {
+    ArtHeader h{ART_NODE16};
+    uint8_t keys[16];
+    ArtHeader* children[16];
+};
+struct ArtNode48 {
+    ArtHeader h{ART_NODE48};
+    uint8_t index[256]; // slot + 1 of each byte's child, 0 when there is none
+    ArtHeader* children[48];
+
+    ArtNode48() { std::memset(index, 0, sizeof(index)); }
+};
+struct ArtNode256 {
+    ArtHeader h{ART_NODE256};
+    ArtHeader* children[256];
+
+    ArtNode256() { std::fill(std::begin(children), std::end(children), nullptr); }
+};
+
+// Ordered map from an integer key (up to 64 bits) to Value on an adaptive radix tree. Lookups cost
+// one node per distinct key byte at most, and the small node sizes keep sparse levels compact.
+// Keys are unique: inserting an existing key replaces its value. Cursors walk keys in order from
+// either end, so the tree can stand in for BasicBPlus inside PostingIndex.
+template <typename Key, typename Value>
+class AdaptiveRadixTree {
+    static_assert(std::is_integral_v<Key> && sizeof(Key) <= 8, "keys are split into at most 8 bytes");
+    static constexpr int kBytes = sizeof(Key);
+    using Leaf = ArtLeaf<Value>;
+
+public:
+    using key_type = Key;
+    using value_type = Value;
+
+    AdaptiveRadixTree() = default;
+    AdaptiveRadixTree(const AdaptiveRadixTree&) = delete; // owns its nodes
+    AdaptiveRadixTree& operator=(const AdaptiveRadixTree&) = delete;
+    ~AdaptiveRadixTree() { clear(); }
+
+    void insert(const Key& key, const Value& value) { insertAt(&root, encode(key), value, 0); }
+
+    Value search(const Key& key) const { // Value() when the key is absent
+        uint64_t bits = encode(key);
+        const ArtHeader* node = root;
+        int depth = 0;
+        while (node != nullptr) {
+            if (node->type == ART_LEAF) {
+                const Leaf* leaf = reinterpret_cast<const Leaf*>(node);
+                return leaf->bits == bits ? leaf->value : Value();
+            }
+            for (int i = 0; i < node->prefixLen; i++) {
+                if (node->prefix[i] != byteAt(bits, depth + i)) return Value();
+            }
+            depth += node->prefixLen;
+            ArtHeader* const* child = findChild(const_cast<ArtHeader*>(node), byteAt(bits, depth));
+            if (child == nullptr) return Value();
+            node = *child;
+            depth++;
+        }
+        return Value();
+    }
+
+    // walks the entries with keys in [low, high], ascending when Forward, else descending. Keeps
+    // the path to the current leaf, one frame per inner node, so next() resumes where it stopped.
+    template <bool Forward>
+    class BasicCursor {
+    public:
+        bool valid() const { return leaf != nullptr; }
+        Key key() const { return decode(leaf->bits); }
+        const Value& value() const { return leaf->value; }
+        void next() { advance(); }
+
+    private:
+        friend class AdaptiveRadixTree;
+        struct Frame {
+            const ArtHeader* node;
+            int byte; // branch of node the cursor is under
+        };
+        Frame stack[kBytes];
+        int top = 0;
+        const Leaf* leaf = nullptr;
+        uint64_t stop; // last key in scan order
+
+        BasicCursor() = default;
+        BasicCursor(const ArtHeader* root, uint64_t from, uint64_t stop) : stop(stop) { seek(root, from); }
+
+        void seek(const ArtHeader* node, uint64_t bits) {
+            int depth = 0;
+            while (node != nullptr) {
+                if (node->type == ART_LEAF) {
+                    const Leaf* l = reinterpret_cast<const Leaf*>(node);
+                    if (Forward ? l->bits >= bits : l->bits <= bits) settle(l);
+                    else advance();
+                    return;
+                }
+                int cmp = 0;
+                for (int i = 0; i < node->prefixLen && cmp == 0; i++) {
+                    uint8_t b = byteAt(bits, depth + i);
+                    if (node->prefix[i] != b) cmp = node->prefix[i] < b ? -1 : 1;
+                }
+                if (cmp != 0) { // the whole subtree lies on one side of bits
+                    if (Forward ? cmp > 0 : cmp < 0) settle(edge(node));
+                    else advance();
+                    return;
+                }
+                depth += node->prefixLen;
+                uint8_t b = byteAt(bits, depth);
+                int at = 0;
+                const ArtHeader* child = Forward ? childFrom(node, b, at) : childDownFrom(node, b, at);
+                if (child == nullptr) {
+                    advance();
+                    return;
+                }
+                stack[top++] = Frame{node, at};
+                if (at != b) { // every key under child is past bits already
+                    settle(edge(child));
+                    return;
+                }
+                node = child;
+                depth++;
+            }
+            leaf = nullptr;
+        }
+        // the next sibling subtree up the path, then its first leaf in scan order
+        void advance() {
+            while (top > 0) {
+                Frame& f = stack[top - 1];
+                int at = 0;
+                const ArtHeader* child = nullptr;
+                if (Forward && f.byte < 255) child = childFrom(f.node, f.byte + 1, at);
+                if (!Forward && f.byte > 0) child = childDownFrom(f.node, f.byte - 1, at);
+                if (child != nullptr) {
+                    f.byte = at;
+                    settle(edge(child));
+                    return;
+                }
+                top--;
+            }
+            leaf = nullptr;
+        }
+        // first leaf of the subtree in scan order, pushing the way down
+        const Leaf* edge(const ArtHeader* node) {
+            while (node->type != ART_LEAF) {
+                int at = 0;
+                const ArtHeader* child = Forward ? childFrom(node, 0, at) : childDownFrom(node, 255, at);
+                stack[top++] = Frame{node, at};
+                node = child;
+            }
+            return reinterpret_cast<const Leaf*>(node);
+        }
+        void settle(const Leaf* l) { leaf = (Forward ? l->bits > stop : l->bits < stop) ? nullptr : l; }
+    };
+    using Cursor = BasicCursor<true>;
+    using ReverseCursor = BasicCursor<false>;
+
+    Cursor cursor(const Key& low, const Key& high) const {
+        if (high < low) return Cursor();
+        return Cursor(root, encode(low), encode(high));
+    }
+    ReverseCursor reverseCursor(const Key& low, const Key& high) const {
+        if (high < low) return ReverseCursor();
+        return ReverseCursor(root, encode(high), encode(low));
+    }
+
+    // every value with a key in [low, high], in key order, after skipping offset and at most limit
+    std::vector<Value> rangeQuery(const Key& low, const Key& high, size_t limit = SIZE_MAX, size_t offset = 0) const {
+        std::vector<Value> out;
+        Cursor c = cursor(low, high);
+        for (; c.valid() && offset > 0; c.next()) offset--;
+        for (; c.valid() && out.size() < limit; c.next()) out.push_back(c.value());
+        return out;
+    }
+
+    // calls f(key, value) on every entry with a key in [low, high], in key order; f may change the
+    // value in place (the tree is not const here, so neither are its leaves)
+    template <typename F>
+    void updateValues(const Key& low, const Key& high, F f) {
+        for (Cursor c = cursor(low, high); c.valid(); c.next()) {
+            f(c.key(), const_cast<Leaf*>(c.leaf)->value);
+        }
+    }
+
+    // entries are (key, value) pairs sorted by key; a repeated key keeps its last value, as with
+    // insert. The nodes are made straight from the sorted run (see buildSorted), none is split or
+    // grown. fillFactor is accepted for the same signature as the B+ trees and ignored: radix nodes
+    // have no slack to leave.
+    template <typename It>
+    void bulkLoad(It first, It last, double = 1.0) {
+        clear();
+        std::vector<std::pair<uint64_t, Value>> sorted;
+        for (It it = first; it != last; ++it) {
+            uint64_t bits = encode(it->first);
+            if (!sorted.empty() && sorted.back().first == bits) sorted.back().second = it->second;
+            else sorted.emplace_back(bits, it->second);
+        }
+        if (!sorted.empty()) root = buildSorted(sorted, 0, sorted.size(), 0);
+    }
+
+    size_t size() const { return entries; }
+
+    void clear() {
+        leaves.releaseAll();
+        nodes4.releaseAll();
+        nodes16.releaseAll();
+        nodes48.releaseAll();
+        nodes256.releaseAll();
+        root = nullptr;
+        entries = 0;
+    }
+
+    // persistence: the entries in key order, the nodes are rebuilt from them on load
+    template <typename Record>
+    void serialize(std::ostream& out, const Record* base) const {
+        std::vector<Key> keys;
+        std::vector<Value> values;
+        keys.reserve(entries);
+        values.reserve(entries);
+        for (Cursor c = cursor(std::numeric_limits<Key>::min(), std::numeric_limits<Key>::max()); c.valid(); c.next()) {
+            keys.push_back(c.key());
+            values.push_back(c.value());
+        }
+        writePod(out, shape());
+        writePod<uint64_t>(out, keys.size());
+        writePods(out, keys.data(), keys.size());
+        writeValues(out, values.data(), static_cast<int>(values.size()), base);
+    }
+    template <typename Record>
+    bool deserialize(ByteReader& in, Record* base, size_t recordCount) {
+        clear();
+        TreeShape stored{};
+        uint64_t n = 0;
+        if (!in.read(stored) || !(stored == shape()) || !in.read(n) || n > recordCount) return false;
+        std::vector<Key> keys(static_cast<size_t>(n));
+        std::vector<Value> values(static_cast<size_t>(n));
+        if (!in.readN(keys.data(), keys.size()) || !readValues(in, values.data(), static_cast<int>(n), base, recordCount)) return false;
+        std::vector<std::pair<uint64_t, Value>> sorted;
+        sorted.reserve(keys.size());
+        for (size_t i = 0; i < keys.size(); i++) {
+            if (i > 0 && !(keys[i - 1] < keys[i])) return false;
+            sorted.emplace_back(encode(keys[i]), values[i]);
+        }
+        if (!sorted.empty()) root = buildSorted(sorted, 0, sorted.size(), 0);
+        return true;
+    }
+
+    // read mem for ui: what the node slabs actually take, unused slab space included
+    size_t approxBytes() const {
+        return leaves.bytesReserved() + nodes4.bytesReserved() + nodes16.bytesReserved()
+             + nodes48.bytesReserved() + nodes256.bytesReserved();
+    }
+
+private:
+    NodePool<Leaf> leaves;
+    NodePool<ArtNode4> nodes4;
+    NodePool<ArtNode16> nodes16;
+    NodePool<ArtNode48> nodes48;
+    NodePool<ArtNode256> nodes256;
+    ArtHeader* root = nullptr;
+    size_t entries = 0;
+
+    static TreeShape shape() { return TreeShape{sizeof(Key), sizeof(Value), 256}; }
+
+    // flipping the sign bit makes signed keys compare like their unsigned bytes, most significant first
+    static uint64_t encode(const Key& key) {
+        uint64_t u = static_cast<uint64_t>(static_cast<std::make_unsigned_t<Key>>(key));
+        if constexpr (std::is_signed_v<Key>) u ^= uint64_t(1) << (kBytes * 8 - 1);
+        return u;
+    }
+    static Key decode(uint64_t u) {
+        if constexpr (std::is_signed_v<Key>) u ^= uint64_t(1) << (kBytes * 8 - 1);
+        return static_cast<Key>(static_cast<std::make_unsigned_t<Key>>(u));
+    }
+    static uint8_t byteAt(uint64_t bits, int depth) { return static_cast<uint8_t>(bits >> (8 * (kBytes - 1 - depth))); }
+
+    // slot of the child for byte b, nullptr when there is none
+    static ArtHeader** findChild(ArtHeader* node, uint8_t b) {
+        switch (node->type) {
+        case ART_NODE4: {
+            ArtNode4* n = reinterpret_cast<ArtNode4*>(node);
+            for (int i = 0; i < n->h.count; i++) {
+                if (n->keys[i] == b) return &n->children[i];
+            }
+            return nullptr;
+        }
+        case ART_NODE16: {
+            ArtNode16* n = reinterpret_cast<ArtNode16*>(node);
+#if defined(__SSE2__)
+            __m128i hits = _mm_cmpeq_epi8(_mm_set1_epi8(static_cast<char>(b)), _mm_loadu_si128(reinterpret_cast<const __m128i*>(n->keys)));
+            unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(hits)) & ((1u << n->h.count) - 1);
+            return mask != 0 ? &n->children[__builtin_ctz(mask)] : nullptr;
+#else
+            for (int i = 0; i < n->h.count; i++) {
+                if (n->keys[i] == b) return &n->children[i];
+            }
+            return nullptr;
+#endif
+        }
+        case ART_NODE48: {
+            ArtNode48* n = reinterpret_cast<ArtNode48*>(node);
+            return n->index[b] != 0 ? &n->children[n->index[b] - 1] : nullptr;
+        }
+        case ART_NODE256: {
+            ArtNode256* n = reinterpret_cast<ArtNode256*>(node);
+            return n->children[b] != nullptr ? &n->children[b] : nullptr;
+        }
+        }
+        return nullptr;
+    }
+
+    // first child with byte >= b (childFrom) or last with byte <= b (childDownFrom), its byte in at
+    static const ArtHeader* childFrom(const ArtHeader* node, int b, int& at) {
+        switch (node->type) {
+        case ART_NODE4:
+        case ART_NODE16: {
+            const uint8_t* keys = node->type == ART_NODE4 ? reinterpret_cast<const ArtNode4*>(node)->keys : reinterpret_cast<const ArtNode16*>(node)->keys;
+            ArtHeader* const* children = node->type == ART_NODE4 ? reinterpret_cast<const ArtNode4*>(node)->children : reinterpret_cast<const ArtNode16*>(node)->children;
+            for (int i = 0; i < node->count; i++) {
+                if (keys[i] >= b) {
+                    at = keys[i];
+                    return children[i];
+                }
+            }
+            return nullptr;
+        }
+        case ART_NODE48: {
+            const ArtNode48* n = reinterpret_cast<const ArtNode48*>(node);
+            for (int c = b; c < 256; c++) {
+                if (n->index[c] != 0) {
+                    at = c;
+                    return n->children[n->index[c] - 1];
+                }
+            }
+            return nullptr;
+        }
+        case ART_NODE256: {
+            const ArtNode256* n = reinterpret_cast<const ArtNode256*>(node);
+            for (int c = b; c < 256; c++) {
+                if (n->children[c] != nullptr) {
+                    at = c;
+                    return n->children[c];
+                }
+            }
+            return nullptr;
+        }
+        }
+        return nullptr;
+    }
+    static const ArtHeader* childDownFrom(const ArtHeader* node, int b, int& at) {
+        switch (node->type) {
+        case ART_NODE4:
+        case ART_NODE16: {
+            const uint8_t* keys = node->type == ART_NODE4 ? reinterpret_cast<const ArtNode4*>(node)->keys : reinterpret_cast<const ArtNode16*>(node)->keys;
+            ArtHeader* const* children = node->type == ART_NODE4 ? reinterpret_cast<const ArtNode4*>(node)->children : reinterpret_cast<const ArtNode16*>(node)->children;
+            for (int i = node->count - 1; i >= 0; i--) {
+                if (keys[i] <= b) {
+                    at = keys[i];
+                    return children[i];
+                }
+            }
+            return nullptr;
+        }
+        case ART_NODE48: {
+            const ArtNode48* n = reinterpret_cast<const ArtNode48*>(node);
+            for (int c = b; c >= 0; c--) {
+                if (n->index[c] != 0) {
+                    at = c;
+                    return n->children[n->index[c] - 1];
+                }
+            }
+            return nullptr;
+        }
+        case ART_NODE256: {
+            const ArtNode256* n = reinterpret_cast<const ArtNode256*>(node);
+            for (int c = b; c >= 0; c--) {
+                if (n->children[c] != nullptr) {
+                    at = c;
+                    return n->children[c];
+                }
+            }
+            return nullptr;
+        }
+        }
+        return nullptr;
+    }
+
+    ArtHeader* newLeaf(uint64_t bits, const Value& value) {
+        entries++;
+        return &leaves.create(bits, value)->h;
+    }
+
+    // the subtree for e[lo, hi) (sorted, distinct, not empty), whose keys agree on the bytes before
+    // depth. Sorted keys share whatever their first and last share, which becomes the prefix; each
+    // run of equal next bytes becomes one child, and the node is sized for the number of runs.
+    // Gives the same shape inserting the keys would.
+    ArtHeader* buildSorted(const std::vector<std::pair<uint64_t, Value>>& e, size_t lo, size_t hi, int depth) {
+        if (hi - lo == 1) return newLeaf(e[lo].first, e[lo].second);
+        int common = 0;
+        while (byteAt(e[lo].first, depth + common) == byteAt(e[hi - 1].first, depth + common)) common++;
+        int d = depth + common;
+        int kids = 1;
+        for (size_t i = lo + 1; i < hi; i++) kids += byteAt(e[i].first, d) != byteAt(e[i - 1].first, d);
+        ArtHeader* node = kids <= 4 ? &nodes4.create()->h : kids <= 16 ? &nodes16.create()->h
+                        : kids <= 48 ? &nodes48.create()->h : &nodes256.create()->h;
+        node->prefixLen = static_cast<uint8_t>(common);
+        for (int i = 0; i < common; i++) node->prefix[i] = byteAt(e[lo].first, depth + i);
+        for (size_t i = lo; i < hi;) {
+            uint8_t b = byteAt(e[i].first, d);
+            size_t j = i + 1;
+            while (j < hi && byteAt(e[j].first, d) == b) j++;
+            addChild(&node, b, buildSorted(e, i, j, d + 1)); // has room, never grows
+            i = j;
+        }
+        return node;
+    }
+
+    // slot holds the subtree for the key bytes from depth on
+    void insertAt(ArtHeader** slot, uint64_t bits, const Value& value, int depth) {
+        for (;;) {
+            ArtHeader* node = *slot;
+            if (node == nullptr) {
+                *slot = newLeaf(bits, value);
+                return;
+            }
+            if (node->type == ART_LEAF) {
+                Leaf* leaf = reinterpret_cast<Leaf*>(node);
+                if (leaf->bits == bits) {
+                    leaf->value = value;
+                    return;
+                }
+                // lazy expansion ends here: a node4 over the bytes both keys share, one leaf each side
+                ArtNode4* split = nodes4.create();
+                int common = 0;
+                while (byteAt(leaf->bits, depth + common) == byteAt(bits, depth + common)) common++;
+                split->h.prefixLen = static_cast<uint8_t>(common);
+                for (int i = 0; i < common; i++) split->h.prefix[i] = byteAt(bits, depth + i);
+                addSorted(split->keys, split->children, split->h.count, byteAt(leaf->bits, depth + common), node);
+                addSorted(split->keys, split->children, split->h.count, byteAt(bits, depth + common), newLeaf(bits, value));
+                *slot = &split->h;
+                return;
+            }
+            int match = 0;
+            while (match < node->prefixLen && node->prefix[match] == byteAt(bits, depth + match)) match++;
+            if (match < node->prefixLen) { // the key leaves the compressed path: split the prefix at match
+                ArtNode4* split = nodes4.create();
+                split->h.prefixLen = static_cast<uint8_t>(match);
+                std::memcpy(split->h.prefix, node->prefix, static_cast<size_t>(match));
+                addSorted(split->keys, split->children, split->h.count, node->prefix[match], node);
+                node->prefixLen = static_cast<uint8_t>(node->prefixLen - match - 1);
+                std::memmove(node->prefix, node->prefix + match + 1, node->prefixLen);
+                addSorted(split->keys, split->children, split->h.count, byteAt(bits, depth + match), newLeaf(bits, value));
+                *slot = &split->h;
+                return;
+            }
+            depth += node->prefixLen;
+            uint8_t b = byteAt(bits, depth);
+            ArtHeader** child = findChild(node, b);
+            if (child == nullptr) {
+                addChild(slot, b, newLeaf(bits, value));
+                return;
+            }
+            slot = child;
+            depth++;
+        }
+    }
+
+    static void addSorted(uint8_t* keys, ArtHeader** children, uint16_t& count, uint8_t b, ArtHeader* child) {
+        int i = count;
+        while (i > 0 && keys[i - 1] > b) {
+            keys[i] = keys[i - 1];
+            children[i] = children[i - 1];
+            i--;
+        }
+        keys[i] = b;
+        children[i] = child;
+        count++;
+    }
+
+    // adds a child for byte b to *slot, first moving a full node into the next size up
+    void addChild(ArtHeader** slot, uint8_t b, ArtHeader* child) {
+        ArtHeader* node = *slot;
+        switch (node->type) {
+        case ART_NODE4: {
+            ArtNode4* n = reinterpret_cast<ArtNode4*>(node);
+            if (n->h.count < 4) {
+                addSorted(n->keys, n->children, n->h.count, b, child);
+                return;
+            }
+            ArtNode16* grown = nodes16.create();
+            grown->h = n->h;
+            grown->h.type = ART_NODE16;
+            std::copy(n->keys, n->keys + 4, grown->keys);
+            std::copy(n->children, n->children + 4, grown->children);
+            nodes4.destroy(n);
+            *slot = &grown->h;
+            addSorted(grown->keys, grown->children, grown->h.count, b, child);
+            return;
+        }
+        case ART_NODE16: {
+            ArtNode16* n = reinterpret_cast<ArtNode16*>(node);
+            if (n->h.count < 16) {
+                addSorted(n->keys, n->children, n->h.count, b, child);
+                return;
+            }
+            ArtNode48* grown = nodes48.create();
+            grown->h = n->h;
+            grown->h.type = ART_NODE48;
+            for (int i = 0; i < 16; i++) {
+                grown->index[n->keys[i]] = static_cast<uint8_t>(i + 1);
+                grown->children[i] = n->children[i];
+            }
+            nodes16.destroy(n);
+            *slot = &grown->h;
+            node = &grown->h;
+            [[fallthrough]];
+        }
+        case ART_NODE48: {
+            ArtNode48* n = reinterpret_cast<ArtNode48*>(node);
+            if (n->h.count < 48) { // nothing is ever removed, so slots fill up in order
+                n->index[b] = static_cast<uint8_t>(n->h.count + 1);
+                n->children[n->h.count++] = child;
+                return;
+            }
+            ArtNode256* grown = nodes256.create();
+            grown->h = n->h;
+            grown->h.type = ART_NODE256;
+            for (int c = 0; c < 256; c++) {
+                if (n->index[c] != 0) grown->children[c] = n->children[n->index[c] - 1];
+            }
+            nodes48.destroy(n);
+            *slot = &grown->h;
+            node = &grown->h;
+            [[fallthrough]];
+        }
+        case ART_NODE256: {
+            ArtNode256* n = reinterpret_cast<ArtNode256*>(node);
+            n->children[b] = child;
+            n->h.count++;
+            return;
+        }
+        }
+    }
+};
+
+#endif //ADAPTIVERADIXTREE_H
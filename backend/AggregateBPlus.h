@@ -0,0 +1,338 @@
+#ifndef AGGREGATEBPLUS_H
+#define AGGREGATEBPLUS_H
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <ostream>
+#include <vector>
+#include "KeySearch.h"
+#include "NodePool.h"
+#include "Serialize.h"
+
+// count, sum, min and max of a measure over some records; min/max mean nothing while count is 0
+struct RangeAggregate {
+    uint64_t count = 0;
+    int64_t sum = 0;
+    int64_t min = std::numeric_limits<int64_t>::max();
+    int64_t max = std::numeric_limits<int64_t>::min();
+
+    void add(int64_t v) {
+        count++;
+        sum += v;
+        min = std::min(min, v);
+        max = std::max(max, v);
+    }
+    void merge(const RangeAggregate& o) {
+        count += o.count;
+        sum += o.sum;
+        min = std::min(min, o.min);
+        max = std::max(max, o.max);
+    }
+};
+
+// leaves hold each distinct key once with the aggregate of its records; internal nodes hold the
+// aggregate of everything under each child
+template <typename Key, int Order>
+struct alignas(64) AggregateNode {
+    static const int order = Order;
+    bool isLeaf;
+    int keyCount = 0;
+    Key keys[order-1];
+    RangeAggregate aggs[order]; // leaves: one per key, internal nodes: one per child
+    AggregateNode* children[order];
+
+    AggregateNode(bool leaf = false) : isLeaf(leaf) {
+        for (int i = 0; i < order-1; i++) {
+            keys[i] = Key();
+        }
+        for (int i = 0; i < order; i++) {
+            children[i] = nullptr;
+        }
+    }
+};
+
+// largest order whose node fits in the given bytes, as bplusOrderForBytes
+template <typename Key>
+constexpr int aggregateOrderForBytes(size_t bytes) {
+    int o = 3;
+    auto nodeBytes = [](int order) {
+        return 8 + (order - 1) * sizeof(Key) + order * (sizeof(RangeAggregate) + sizeof(void*));
+    };
+    while (nodeBytes(o + 1) <= bytes) o++;
+    return o;
+}
+
+// B+ tree for range aggregates of one measure (Measure maps a record to an int64, e.g. its price
+// ticks). A query for [low, high] takes whole-child aggregates from every node between the
+// root-to-leaf paths of low and high and only descends along those two paths, so it reads
+// O(height * order) entries however many records the range covers. Built by bulk load; a key's
+// aggregate can then be replaced in place (assign), which only touches that key's path.
+template <typename Key, typename Record, typename Measure, int Order = 16>
+class AggregateBPlus {
+public:
+    using key_type = Key;
+
+    AggregateBPlus() = default;
+    AggregateBPlus(const AggregateBPlus&) = delete; // owns its nodes
+    AggregateBPlus& operator=(const AggregateBPlus&) = delete;
+    ~AggregateBPlus() { clear(); }
+
+    // entries are (key, record pointer) pairs sorted by key, as for the plain trees; records that
+    // share a key are folded into one leaf entry
+    template <typename It>
+    void bulkLoad(It first, It last, double fillFactor = 1.0) {
+        clear();
+        std::vector<std::pair<Key, RangeAggregate>> keys;
+        for (It it = first; it != last; ++it) {
+            if (keys.empty() || !(keys.back().first == it->first)) keys.emplace_back(it->first, RangeAggregate{});
+            keys.back().second.add(measure(it->second));
+        }
+        size_t n = keys.size();
+        if (n == 0) return;
+        const int full = maxKeys; // copy, min/max take references
+        int fill = std::max(1, std::min(full, static_cast<int>(full * fillFactor + 0.5)));
+
+        std::vector<Node*> level;
+        std::vector<Key> lowKeys; // smallest key under each node of the current level
+        size_t groups = (n + fill - 1) / fill;
+        size_t at = 0;
+        for (size_t g = 0; g < groups; g++) {
+            Node* leaf = pool.create(true);
+            int count = static_cast<int>(n / groups + (g < n % groups ? 1 : 0));
+            for (int k = 0; k < count; k++, at++) {
+                leaf->keys[k] = keys[at].first;
+                leaf->aggs[k] = keys[at].second;
+            }
+            leaf->keyCount = count;
+            level.push_back(leaf);
+            lowKeys.push_back(leaf->keys[0]);
+        }
+        while (level.size() > 1) {
+            size_t c = level.size();
+            size_t parents = (c + fill) / (fill + 1);
+            std::vector<Node*> upper;
+            std::vector<Key> upperLows;
+            size_t child = 0;
+            for (size_t g = 0; g < parents; g++) {
+                size_t kids = c / parents + (g < c % parents ? 1 : 0);
+                Node* node = pool.create(false);
+                upperLows.push_back(lowKeys[child]);
+                for (size_t k = 0; k < kids; k++, child++) {
+                    node->children[k] = level[child];
+                    node->aggs[k] = nodeTotal(level[child]);
+                    if (k > 0) node->keys[k - 1] = lowKeys[child];
+                }
+                node->keyCount = static_cast<int>(kids - 1);
+                upper.push_back(node);
+            }
+            level.swap(upper);
+            lowKeys.swap(upperLows);
+        }
+        root = level[0];
+    }
+
+    // aggregate of the measure over every record with a key in [low, high]
+    RangeAggregate aggregate(const Key& low, const Key& high) const {
+        if (root == nullptr || high < low) return RangeAggregate{};
+        return collect(root, low, high, false, false);
+    }
+    RangeAggregate total() const { return root == nullptr ? RangeAggregate{} : nodeTotal(root); }
+
+    // sets key's aggregate to agg (what its records add up to now, e.g. after one of them changed)
+    // and redoes the summaries on its root-to-leaf path. A key the tree does not have yet is added,
+    // splitting full nodes on the way back up. Min and max can't be taken back out of a summary,
+    // which is why the caller passes the key's whole aggregate rather than the one record that moved.
+    // A key whose records are all gone keeps an empty entry (count 0) until the next bulk load.
+    void assign(const Key& key, const RangeAggregate& agg) {
+        if (root == nullptr) {
+            if (agg.count == 0) return;
+            root = pool.create(true);
+        }
+        Key splitKey{};
+        Node* right = assignIn(root, key, agg, splitKey);
+        if (right != nullptr) {
+            Node* top = pool.create(false);
+            top->keyCount = 1;
+            top->keys[0] = splitKey;
+            top->children[0] = root;
+            top->children[1] = right;
+            top->aggs[0] = nodeTotal(root);
+            top->aggs[1] = nodeTotal(right);
+            root = top;
+        }
+    }
+
+    void clear() {
+        pool.releaseAll();
+        root = nullptr;
+    }
+
+    // persistence: preorder dump of keys and leaf aggregates; internal aggregates are rebuilt on load
+    template <typename R>
+    void serialize(std::ostream& out, const R*) const {
+        writePod(out, shape());
+        writePod<uint8_t>(out, root != nullptr);
+        if (root != nullptr) writeNode(out, root);
+    }
+    template <typename R>
+    bool deserialize(ByteReader& in, R*, size_t) {
+        clear();
+        TreeShape stored{};
+        uint8_t hasRoot = 0;
+        if (!in.read(stored) || !(stored == shape()) || !in.read(hasRoot)) return false;
+        if (!hasRoot) return true;
+        root = readNode(in, 0);
+        if (root == nullptr) clear();
+        return root != nullptr;
+    }
+
+    // read mem for ui: what the node slabs actually take, unused slab space included
+    size_t approxBytes() const { return pool.bytesReserved(); }
+
+private:
+    using Node = AggregateNode<Key, Order>;
+    static constexpr int maxKeys = Order-1;
+
+    NodePool<Node> pool;
+    Node* root = nullptr;
+    Measure measure;
+
+    static TreeShape shape() { return TreeShape{sizeof(Key), sizeof(RangeAggregate), static_cast<uint32_t>(Order)}; }
+
+    static RangeAggregate nodeTotal(const Node* node) {
+        RangeAggregate a;
+        int slots = node->isLeaf ? node->keyCount : node->keyCount + 1;
+        for (int i = 0; i < slots; i++) a.merge(node->aggs[i]);
+        return a;
+    }
+
+    // aboveLow / belowHigh say the whole node is already known to be >= low / <= high. Child i of an
+    // internal node holds keys in [keys[i-1], keys[i]), so only the children holding low and high
+    // can be partly in range; every child between them is taken whole.
+    RangeAggregate collect(const Node* node, const Key& low, const Key& high, bool aboveLow, bool belowHigh) const {
+        RangeAggregate a;
+        int n = node->keyCount;
+        if (node->isLeaf) {
+            int from = aboveLow ? 0 : keysearch::lowerIndex(node->keys, n, low);
+            int to = belowHigh ? n : keysearch::upperIndex(node->keys, n, high);
+            for (int i = from; i < to; i++) a.merge(node->aggs[i]);
+            return a;
+        }
+        int first = aboveLow ? 0 : keysearch::upperIndex(node->keys, n, low);
+        int last = belowHigh ? n : keysearch::upperIndex(node->keys, n, high);
+        for (int i = first; i <= last; i++) {
+            bool whole = (aboveLow || i > first) && (belowHigh || i < last);
+            if (whole) a.merge(node->aggs[i]);
+            else a.merge(collect(node->children[i], low, high, aboveLow || i > first, belowHigh || i < last));
+        }
+        return a;
+    }
+
+    // assign below node; returns the new right sibling when node had to split (splitKey is the
+    // smallest key under it), else nullptr
+    Node* assignIn(Node* node, const Key& key, const RangeAggregate& agg, Key& splitKey) {
+        int n = node->keyCount;
+        if (node->isLeaf) {
+            int i = keysearch::lowerIndex(node->keys, n, key);
+            if (i < n && node->keys[i] == key) {
+                node->aggs[i] = agg;
+                return nullptr;
+            }
+            if (agg.count == 0) return nullptr; // nothing there to empty
+            Key keys[maxKeys + 1];
+            RangeAggregate aggs[maxKeys + 1];
+            std::copy(node->keys, node->keys + i, keys);
+            std::copy(node->aggs, node->aggs + i, aggs);
+            keys[i] = key;
+            aggs[i] = agg;
+            std::copy(node->keys + i, node->keys + n, keys + i + 1);
+            std::copy(node->aggs + i, node->aggs + n, aggs + i + 1);
+            n++;
+            if (n <= maxKeys) {
+                std::copy(keys, keys + n, node->keys);
+                std::copy(aggs, aggs + n, node->aggs);
+                node->keyCount = n;
+                return nullptr;
+            }
+            int left = n / 2;
+            Node* right = pool.create(true);
+            std::copy(keys, keys + left, node->keys);
+            std::copy(aggs, aggs + left, node->aggs);
+            node->keyCount = left;
+            std::copy(keys + left, keys + n, right->keys);
+            std::copy(aggs + left, aggs + n, right->aggs);
+            right->keyCount = n - left;
+            splitKey = right->keys[0];
+            return right;
+        }
+        int c = keysearch::upperIndex(node->keys, n, key);
+        Key childSplit{};
+        Node* grown = assignIn(node->children[c], key, agg, childSplit);
+        node->aggs[c] = nodeTotal(node->children[c]);
+        if (grown == nullptr) return nullptr;
+
+        // the child split: its new right half goes in after it, with childSplit as the separator
+        Key keys[maxKeys + 1];
+        Node* children[maxKeys + 2];
+        RangeAggregate aggs[maxKeys + 2];
+        std::copy(node->keys, node->keys + c, keys);
+        keys[c] = childSplit;
+        std::copy(node->keys + c, node->keys + n, keys + c + 1);
+        std::copy(node->children, node->children + c + 1, children);
+        std::copy(node->aggs, node->aggs + c + 1, aggs);
+        children[c + 1] = grown;
+        aggs[c + 1] = nodeTotal(grown);
+        std::copy(node->children + c + 1, node->children + n + 1, children + c + 2);
+        std::copy(node->aggs + c + 1, node->aggs + n + 1, aggs + c + 2);
+        n++;
+        if (n <= maxKeys) {
+            std::copy(keys, keys + n, node->keys);
+            std::copy(children, children + n + 1, node->children);
+            std::copy(aggs, aggs + n + 1, node->aggs);
+            node->keyCount = n;
+            return nullptr;
+        }
+        // n keys, n + 1 children: the left keeps mid keys, keys[mid] moves up, the right takes the rest
+        int mid = n / 2;
+        Node* right = pool.create(false);
+        std::copy(keys, keys + mid, node->keys);
+        std::copy(children, children + mid + 1, node->children);
+        std::copy(aggs, aggs + mid + 1, node->aggs);
+        node->keyCount = mid;
+        std::copy(keys + mid + 1, keys + n, right->keys);
+        std::copy(children + mid + 1, children + n + 1, right->children);
+        std::copy(aggs + mid + 1, aggs + n + 1, right->aggs);
+        right->keyCount = n - mid - 1;
+        splitKey = keys[mid];
+        return right;
+    }
+
+    void writeNode(std::ostream& out, const Node* node) const {
+        writePod<uint8_t>(out, node->isLeaf);
+        writePod<int32_t>(out, node->keyCount);
+        writePods(out, node->keys, static_cast<size_t>(node->keyCount));
+        if (node->isLeaf) {
+            writePods(out, node->aggs, static_cast<size_t>(node->keyCount));
+            return;
+        }
+        for (int i = 0; i <= node->keyCount; i++) writeNode(out, node->children[i]);
+    }
+    Node* readNode(ByteReader& in, int depth) {
+        uint8_t leaf = 0;
+        int32_t n = 0;
+        if (depth > 64 || !in.read(leaf) || !in.read(n) || n < 0 || n > maxKeys) return nullptr;
+        Node* node = pool.create(leaf != 0);
+        node->keyCount = n;
+        bool ok = in.readN(node->keys, n);
+        if (ok && node->isLeaf) ok = in.readN(node->aggs, n);
+        for (int i = 0; ok && !node->isLeaf && i <= n; i++) {
+            node->children[i] = readNode(in, depth + 1);
+            ok = node->children[i] != nullptr;
+            if (ok) node->aggs[i] = nodeTotal(node->children[i]);
+        }
+        return ok ? node : nullptr; // partial nodes stay in the pool until the caller clears it
+    }
+};
+
+#endif //AGGREGATEBPLUS_H
@@ -1,269 +1,704 @@
-// Created by Isaac Probst on 11/3/2025.
-#ifndef BPLUSTREE_BPLUS_H
-#define BPLUSTREE_BPLUS_H
-#include <algorithm>
-#include <iostream>
-#include <ranges>
-#include <vector>
-using namespace std;
-
-// forward declare MarketRecord to avoid redefinition
-struct MarketRecord;
-
-// NODE STRUCT
-struct Node {
-    bool isLeaf;
-    static const int order = 5;
-    int keyCount;
-    int keys[order-1];
-    Node* children[order];
-    Node* next;
-    MarketRecord* data[order-1];
-
-    Node(bool leaf = false) : isLeaf(leaf), keyCount(0), next(nullptr) {
-        for (int i = 0; i < order-1; i++) {
-            keys[i] = 0;
-            data[i] = nullptr;
-        }
-        for (int i = 0; i < order; i++) {
-            children[i] = nullptr;
-        }
-    }
-};
-
-// B+ TREE CLASS
-class BPlus {
-private:
-    static const int order = 5;
-    static const int maxKeys = order-1;
-    static const int minKeys = maxKeys/2;
-    Node* root = nullptr;
-
-public:
-    BPlus() : root(nullptr) {}
-
-    //scans tree to find the leaf node of the given node
-    Node* findLeaf(Node* node, int key) {
-        if (node == nullptr) {
-            return nullptr;
-        }
-        if (node->isLeaf) {
-            return node;
-        }
-        for (int i = 0; i < node->keyCount; i++) {
-            if (key < node->keys[i]) {
-                return findLeaf(node->children[i], key);
-            }
-        }
-        return findLeaf(node->children[node->keyCount], key);
-    }
-
-    //split for leaves, maintains linkedlist
-    Node* splitLeaf(Node* leaf) {
-        int split = leaf->keyCount/2;
-        Node* newLeaf = new Node(true);
-        newLeaf->next = leaf->next;
-        newLeaf->keyCount = leaf->keyCount - split;
-
-        for (int i = 0; i < newLeaf->keyCount; i++) {
-            newLeaf->keys[i] = leaf->keys[i + split];
-            newLeaf->data[i] = leaf->data[i + split];
-        }
-
-        leaf->keyCount = split;
-        leaf->next = newLeaf;
-        return newLeaf;
-    }
-
-    //for internal nodes
-    Node* splitInternal(Node* internal) {
-        int split = internal->keyCount/2;
-        Node* newInternal = new Node(false);
-
-        newInternal->keyCount = internal->keyCount - split - 1;
-        internal->keyCount = split;
-
-        for (int i = 0; i < newInternal->keyCount; i++) {
-            newInternal->keys[i] = internal->keys[split+i+1];
-            newInternal->children[i] = internal->children[split +i+1];
-        }
-        newInternal->children[newInternal->keyCount] = internal->children[internal->keyCount];
-        internal->keyCount = split;
-        return newInternal;
-    }
-
-    //print for testing
-    void printTree(Node* node, int level = 0) {
-        if(node != nullptr) {
-            for (int i =0; i < level; i++) {
-                cout << "  ";
-            }
-            for (int i = 0; i < node->keyCount; i++) {
-                cout << node->keys[i] << " ";
-            } cout << endl;
-            if (!node->isLeaf) {
-                for (int i = 0; i <= node->keyCount; i++) {
-                    printTree(node->children[i], level+ 1);
-                }
-            }
-        } else cout << "B+ Tree Is Empty!!" << endl;
-    }
-
-    //public print
-    void print() {
-        cout << "B+ Tree Print: " << endl;
-        printTree(root);
-        cout << endl;
-    }
-
-    // RANGE QUERY - gives nodes between a certain index, O(logn) complexity
-    vector<MarketRecord*> rangeQuery(int low, int high) {
-        vector<MarketRecord*> ret;
-        Node* node=root;
-
-        //find leaf
-        while (node != nullptr && !node->isLeaf) {
-            int i = 0;
-            while (i<node->keyCount && low >= node->keys[i]) {
-                i++;
-            }
-            node = node->children[i];
-        }
-
-        //traverse leaf nodes
-        while (node != nullptr) {
-            for (int j = 0; j < node->keyCount; j++ ) {
-                if (high >= node->keys[j] && low <= node->keys[j]) {
-                    ret.push_back(node->data[j]);
-                }
-                else if (node->keys[j] > high) {
-                    return ret;
-                }
-            }
-            node = node->next;
-        }
-        return ret;
-    }
-
-    int findKeyIndex(Node* node, int key) {
-        int i = 0;
-        while(i < node->keyCount && key > node->keys[i]) {
-            i++;
-        }
-        return i;
-    }
-
-    MarketRecord* search(int key) {
-        Node* node=root;
-
-        while (node != nullptr && !node->isLeaf) {
-            int i =0;
-            while (i<node->keyCount && key >= node->keys[i]) {
-                i++;
-            }
-            node = node->children[i];
-        }
-
-        if (!node) return nullptr;
-
-        for (int i = 0; i<node->keyCount; i++) {
-            if (node->keys[i] == key) {
-                return node->data[i];
-            }
-        }
-        return nullptr;
-    }
-
-    //inserts a record into B+, splitting as necessary with helper function
-    void insert(int key, MarketRecord* record) {
-        if (root==nullptr) {
-            root = new Node(true);
-            root->keys[0] = key;
-            root->keyCount = 1;
-            root->data[0] = record;
-            return;
-        }
-
-        if (root->keyCount == maxKeys) {
-            Node* newRoot = new Node(false);
-            newRoot->children[0] = root;
-
-            if (root->isLeaf) {
-                Node* newLeaf = splitLeaf(root);
-                newRoot->children[1] = newLeaf;
-                newRoot->keys[0] = newLeaf->keys[0];
-            } else {
-                Node* newInternal = splitInternal(root);
-                newRoot->children[1] = newInternal;
-                newRoot->keys[0] = root->keys[root->keyCount];
-            }
-
-            newRoot->keyCount = 1;
-            root = newRoot;
-        }
-
-        insertHelper(root, key, record);
-    }
-
-    //recursive helper for insert function
-    void insertHelper(Node* node, int key, MarketRecord* record) {
-        if (node->isLeaf) {
-            int i = node->keyCount - 1;
-            while (i >= 0 && key < node->keys[i]) {
-                node->keys[i + 1] = node->keys[i];
-                node->data[i + 1] = node->data[i];
-                i--;
-            }
-            node->keys[i + 1] = key;
-            node->data[i + 1] = record;
-            node->keyCount++;
-        } else {
-            int j = findKeyIndex(node, key);
-            Node* child = node->children[j];
-
-            if (child->keyCount == maxKeys) {
-                Node* newChild;
-                int promoteKey;
-
-                if (child->isLeaf) {
-                    newChild = splitLeaf(child);
-                    promoteKey = newChild->keys[0];
-                } else {
-                    newChild = splitInternal(child);
-                    promoteKey = child->keys[child->keyCount];
-                }
-
-                for (int k = node->keyCount; k > j; k--) {
-                    node->keys[k] = node->keys[k - 1];
-                    node->children[k + 1] = node->children[k];
-                }
-
-                node->keys[j] = promoteKey;
-                node->children[j + 1] = newChild;
-                node->keyCount++;
-
-                if (key >= promoteKey) {
-                    child = newChild;
-                }
-            }
-
-            insertHelper(child, key, record);
-        }
-    }
-    // read mem for ui
-private:
-    size_t countNodes(Node* n) const {
-        if (!n) return 0;
-        size_t c = 1;
-        if (!n->isLeaf) {
-            for (int i = 0; i <= n->keyCount; ++i)
-                c += countNodes(n->children[i]);
-        }
-        return c;
-    }
-public:
-    size_t approxBytes() const { return countNodes(root) * sizeof(Node); }
-};
-
-
+// Created by Isaac Probst on 11/3/2025.
+#ifndef BPLUSTREE_BPLUS_H
+#define BPLUSTREE_BPLUS_H
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <iterator>
+#include <ranges>
+#include <vector>
+#include "KeySearch.h"
+#include "NodePool.h"
+#include "Serialize.h"
+using namespace std;
+
+// forward declare MarketRecord to avoid redefinition
+struct MarketRecord;
+
+// NODE STRUCT (fanout is a template parameter so node size can be tuned; nodes start on a cache line)
+template <typename Key, typename Value, int Order>
+struct alignas(64) BPlusNode {
+    bool isLeaf;
+    static const int order = Order;
+    int keyCount;
+    Key keys[order-1];
+    Value data[order-1];
+    BPlusNode* children[order];
+    uint32_t counts[order]; // internal nodes: how many entries sit under each child
+    BPlusNode* next;
+    BPlusNode* prev; // leaves are linked both ways so ranges can also be read newest/largest first
+
+    BPlusNode(bool leaf = false) : isLeaf(leaf), keyCount(0), next(nullptr), prev(nullptr) {
+        for (int i = 0; i < order-1; i++) {
+            keys[i] = Key();
+            data[i] = Value();
+        }
+        for (int i = 0; i < order; i++) {
+            children[i] = nullptr;
+            counts[i] = 0;
+        }
+    }
+};
+
+// largest order whose node fits in the given bytes (64 = one cache line, 4096 = a page)
+template <typename Key, typename Value>
+constexpr int bplusOrderForBytes(size_t bytes) {
+    int o = 3;
+    auto nodeBytes = [](int order) {
+        return 8 + (order - 1) * (sizeof(Key) + sizeof(Value)) + (order + 2) * sizeof(void*) + order * sizeof(uint32_t);
+    };
+    while (nodeBytes(o + 1) <= bytes) o++;
+    return o;
+}
+
+// B+ TREE CLASS
+template <typename Key, typename Value, int Order = 5>
+class BasicBPlus {
+public:
+    using key_type = Key;
+    using value_type = Value;
+private:
+    using Node = BPlusNode<Key, Value, Order>;
+    static const int order = Order;
+    static const int maxKeys = order-1;
+    static const int minKeys = maxKeys/2;
+    // inserts split a full internal node on the way down; with two keys that leaves a half with none
+    // (one child), and erase has no sibling to rebalance its child against
+    static_assert(Order >= 4, "B+ tree nodes need room for at least 3 keys");
+    NodePool<Node> pool; // every node lives here, clear() drops them all at once
+    Node* root = nullptr;
+
+public:
+    BasicBPlus() : root(nullptr) {}
+    BasicBPlus(const BasicBPlus&) = delete; // owns its nodes
+    BasicBPlus& operator=(const BasicBPlus&) = delete;
+
+    //scans tree to find the leaf node of the given node
+    Node* findLeaf(Node* node, const Key& key) {
+        if (node == nullptr) {
+            return nullptr;
+        }
+        if (node->isLeaf) {
+            return node;
+        }
+        return findLeaf(node->children[upperKeyIndex(node, key)], key);
+    }
+
+    //split for leaves, maintains linkedlist
+    Node* splitLeaf(Node* leaf) {
+        int split = leaf->keyCount/2;
+        Node* newLeaf = pool.create(true);
+        newLeaf->next = leaf->next;
+        newLeaf->keyCount = leaf->keyCount - split;
+
+        for (int i = 0; i < newLeaf->keyCount; i++) {
+            newLeaf->keys[i] = leaf->keys[i + split];
+            newLeaf->data[i] = leaf->data[i + split];
+        }
+
+        leaf->keyCount = split;
+        if (leaf->next) leaf->next->prev = newLeaf;
+        leaf->next = newLeaf;
+        newLeaf->prev = leaf;
+        return newLeaf;
+    }
+
+    //for internal nodes
+    Node* splitInternal(Node* internal) {
+        int split = internal->keyCount/2;
+        int oldCount = internal->keyCount;
+        Node* newInternal = pool.create(false);
+
+        newInternal->keyCount = oldCount - split - 1;
+
+        for (int i = 0; i < newInternal->keyCount; i++) {
+            newInternal->keys[i] = internal->keys[split+i+1];
+            newInternal->children[i] = internal->children[split +i+1];
+            newInternal->counts[i] = internal->counts[split +i+1];
+        }
+        newInternal->children[newInternal->keyCount] = internal->children[oldCount];
+        newInternal->counts[newInternal->keyCount] = internal->counts[oldCount];
+        internal->keyCount = split;
+        return newInternal;
+    }
+
+    //print for testing
+    void printTree(Node* node, int level = 0) {
+        if(node != nullptr) {
+            for (int i =0; i < level; i++) {
+                cout << "  ";
+            }
+            for (int i = 0; i < node->keyCount; i++) {
+                cout << node->keys[i] << " ";
+            } cout << endl;
+            if (!node->isLeaf) {
+                for (int i = 0; i <= node->keyCount; i++) {
+                    printTree(node->children[i], level+ 1);
+                }
+            }
+        } else cout << "B+ Tree Is Empty!!" << endl;
+    }
+
+    //public print
+    void print() {
+        cout << "B+ Tree Print: " << endl;
+        printTree(root);
+        cout << endl;
+    }
+
+    // CURSOR - forward over the entries with keys in [low, high], one leaf slot at a time along the
+    // next chain, so callers can stream the range or stop early. Valid until the tree is next modified.
+    class Cursor {
+    public:
+        bool valid() const { return node != nullptr; }
+        const Key& key() const { return node->keys[pos]; }
+        const Value& value() const { return node->data[pos]; }
+        void next() {
+            pos++;
+            settle();
+        }
+    private:
+        friend class BasicBPlus;
+        Node* node = nullptr;
+        int pos = 0;
+        Key high{};
+        void settle() { // skips to the next leaf at the end of this one, then stops for good once past high
+            while (node != nullptr && pos >= node->keyCount) {
+                node = node->next;
+                pos = 0;
+            }
+            if (node != nullptr && high < node->keys[pos]) node = nullptr;
+        }
+    };
+    Cursor cursor(const Key& low, const Key& high) {
+        Cursor c;
+        c.high = high;
+        c.node = root;
+        //find leaf, going left on equal keys since copies of a separator can end the left leaf
+        while (c.node != nullptr && !c.node->isLeaf) {
+            c.node = c.node->children[findKeyIndex(c.node, low)];
+        }
+        if (c.node != nullptr) c.pos = findKeyIndex(c.node, low);
+        c.settle();
+        return c;
+    }
+
+    // REVERSE CURSOR - the same range from the largest key down, along the prev chain; reading the
+    // last n entries of a range touches only the leaves that hold them
+    class ReverseCursor {
+    public:
+        bool valid() const { return node != nullptr; }
+        const Key& key() const { return node->keys[pos]; }
+        const Value& value() const { return node->data[pos]; }
+        void next() {
+            pos--;
+            settle();
+        }
+    private:
+        friend class BasicBPlus;
+        Node* node = nullptr;
+        int pos = 0;
+        Key low{};
+        void settle() { // steps back to the previous leaf at the start of this one, then stops once below low
+            while (node != nullptr && pos < 0) {
+                node = node->prev;
+                if (node != nullptr) pos = node->keyCount - 1;
+            }
+            if (node != nullptr && node->keys[pos] < low) node = nullptr;
+        }
+    };
+    ReverseCursor reverseCursor(const Key& low, const Key& high) {
+        ReverseCursor c;
+        c.low = low;
+        c.node = root;
+        // right on equal keys: copies of high can start the leaf right of a separator
+        while (c.node != nullptr && !c.node->isLeaf) {
+            c.node = c.node->children[upperKeyIndex(c.node, high)];
+        }
+        if (c.node != nullptr) c.pos = upperKeyIndex(c.node, high) - 1;
+        c.settle();
+        return c;
+    }
+
+    // RANGE QUERY - gives nodes between a certain index, O(logn) complexity. Skips the first offset
+    // matches and stops after limit, so the leaves past the requested page are never touched
+    vector<Value> rangeQuery(const Key& low, const Key& high, size_t limit = SIZE_MAX, size_t offset = 0) {
+        vector<Value> ret;
+        Cursor c = cursor(low, high);
+        for (; c.valid() && offset > 0; c.next()) {
+            offset--;
+        }
+        for (; c.valid() && ret.size() < limit; c.next()) {
+            ret.push_back(c.value());
+        }
+        return ret;
+    }
+    // same page counted from the top of the range, largest key first
+    vector<Value> reverseRangeQuery(const Key& low, const Key& high, size_t limit = SIZE_MAX, size_t offset = 0) {
+        vector<Value> ret;
+        ReverseCursor c = reverseCursor(low, high);
+        for (; c.valid() && offset > 0; c.next()) {
+            offset--;
+        }
+        for (; c.valid() && ret.size() < limit; c.next()) {
+            ret.push_back(c.value());
+        }
+        return ret;
+    }
+
+    // COUNT - entries with keys in [low, high] from the per-child counts: one root-to-leaf walk for
+    // each end, whatever the width of the range
+    size_t countRange(const Key& low, const Key& high) {
+        if (high < low) return 0;
+        return countBelow(high, true) - countBelow(low, false);
+    }
+    size_t size() const { return root == nullptr ? 0 : subtreeCount(root); }
+
+    int findKeyIndex(Node* node, const Key& key) { // first index whose key is >= key
+        return keysearch::lowerIndex(node->keys, node->keyCount, key);
+    }
+    int upperKeyIndex(Node* node, const Key& key) { // first index whose key is > key
+        return keysearch::upperIndex(node->keys, node->keyCount, key);
+    }
+
+    Value search(const Key& key) { // Value() when the key is absent
+        Node* node=root;
+
+        // left on equal keys like rangeQuery: after erases a separator no longer promises a copy of
+        // itself on its right, so the first copy may sit at the head of a later leaf
+        while (node != nullptr && !node->isLeaf) {
+            node = node->children[findKeyIndex(node, key)];
+        }
+
+        while (node != nullptr) {
+            int i = findKeyIndex(node, key);
+            if (i < node->keyCount) {
+                return node->keys[i] == key ? node->data[i] : Value();
+            }
+            node = node->next;
+        }
+        return Value();
+    }
+
+    //inserts a record into B+, splitting as necessary with helper function
+    void insert(const Key& key, const Value& record) {
+        if (root==nullptr) {
+            root = pool.create(true);
+            root->keys[0] = key;
+            root->keyCount = 1;
+            root->data[0] = record;
+            return;
+        }
+
+        if (root->keyCount == maxKeys) {
+            Node* newRoot = pool.create(false);
+            newRoot->children[0] = root;
+
+            if (root->isLeaf) {
+                Node* newLeaf = splitLeaf(root);
+                newRoot->children[1] = newLeaf;
+                newRoot->keys[0] = newLeaf->keys[0];
+            } else {
+                Node* newInternal = splitInternal(root);
+                newRoot->children[1] = newInternal;
+                newRoot->keys[0] = root->keys[root->keyCount];
+            }
+
+            newRoot->keyCount = 1;
+            newRoot->counts[0] = subtreeCount(newRoot->children[0]);
+            newRoot->counts[1] = subtreeCount(newRoot->children[1]);
+            root = newRoot;
+        }
+
+        insertHelper(root, key, record);
+    }
+
+    //recursive helper for insert function
+    void insertHelper(Node* node, const Key& key, const Value& record) {
+        if (node->isLeaf) {
+            int i = node->keyCount - 1;
+            while (i >= 0 && key < node->keys[i]) {
+                node->keys[i + 1] = node->keys[i];
+                node->data[i + 1] = node->data[i];
+                i--;
+            }
+            node->keys[i + 1] = key;
+            node->data[i + 1] = record;
+            node->keyCount++;
+        } else {
+            int j = findKeyIndex(node, key);
+            Node* child = node->children[j];
+
+            if (child->keyCount == maxKeys) {
+                Node* newChild;
+                Key promoteKey;
+
+                if (child->isLeaf) {
+                    newChild = splitLeaf(child);
+                    promoteKey = newChild->keys[0];
+                } else {
+                    newChild = splitInternal(child);
+                    promoteKey = child->keys[child->keyCount];
+                }
+
+                for (int k = node->keyCount; k > j; k--) {
+                    node->keys[k] = node->keys[k - 1];
+                    node->children[k + 1] = node->children[k];
+                    node->counts[k + 1] = node->counts[k];
+                }
+
+                node->keys[j] = promoteKey;
+                node->children[j + 1] = newChild;
+                node->keyCount++;
+                node->counts[j] = subtreeCount(child);
+                node->counts[j + 1] = subtreeCount(newChild);
+
+                if (key >= promoteKey) {
+                    child = newChild;
+                    j++;
+                }
+            }
+
+            node->counts[j]++;
+            insertHelper(child, key, record);
+        }
+    }
+    // removes the entry with this key and value (keys can repeat, the value says which one), false
+    // if there is none. An underfull node borrows from a sibling or is merged with one, up to the root.
+    bool erase(const Key& key, const Value& record) {
+        vector<pair<Node*, int>> path; // (internal node, child taken) from the root down
+        Node* leaf = nullptr;
+        int pos = -1;
+        if (root == nullptr || !findEntry(root, key, record, path, leaf, pos)) {
+            return false;
+        }
+        for (int i = pos; i < leaf->keyCount - 1; i++) {
+            leaf->keys[i] = leaf->keys[i + 1];
+            leaf->data[i] = leaf->data[i + 1];
+        }
+        leaf->keyCount--;
+        for (auto& step : path) {
+            step.first->counts[step.second]--;
+        }
+
+        Node* node = leaf;
+        while (!path.empty() && node->keyCount < minKeys) {
+            Node* parent = path.back().first;
+            int idx = path.back().second;
+            path.pop_back();
+            rebalanceChild(parent, idx);
+            node = parent;
+        }
+        if (root->keyCount == 0) { // an empty leaf root means an empty tree, an internal one a level less
+            Node* old = root;
+            root = root->isLeaf ? nullptr : root->children[0];
+            pool.destroy(old);
+        }
+        return true;
+    }
+
+    // moves an entry to a new key (a corrected price or timestamp), false if it was not there
+    bool update(const Key& oldKey, const Key& newKey, const Value& record) {
+        if (!erase(oldKey, record)) {
+            return false;
+        }
+        insert(newKey, record);
+        return true;
+    }
+
+    // calls f(key, value) on every entry with a key in [low, high], in key order; f may change the
+    // value in place (the keys, and so the shape of the tree, stay as they are)
+    template <typename F>
+    void updateValues(const Key& low, const Key& high, F f) {
+        for (Cursor c = cursor(low, high); c.valid(); c.next()) {
+            f(c.key(), c.node->data[c.pos]);
+        }
+    }
+
+    // builds the tree bottom-up from entries already sorted by key (pairs of key, value), replacing
+    // the current contents. fillFactor sets how full leaves and internal nodes are packed (1.0 is
+    // densest); no non-root node ends up under minKeys. Leaves are chained left to right as usual.
+    template <typename It>
+    void bulkLoad(It first, It last, double fillFactor = 1.0) {
+        clear();
+        size_t n = static_cast<size_t>(distance(first, last));
+        if (n == 0) return;
+        const int lo = minKeys, hi = maxKeys; // copies, min/max take references
+        int fill = max(lo, min(hi, static_cast<int>(hi * fillFactor + 0.5)));
+
+        vector<Node*> level;
+        vector<Key> lowKeys; // smallest key under each node of the current level
+        size_t groups = bulkGroupCount(n, fill, minKeys);
+        pool.reserve(groups + groups / minKeys + 1); // leaves plus a bound on the levels above
+        It it = first;
+        Node* prev = nullptr;
+        for (size_t g = 0; g < groups; g++) {
+            size_t count = bulkGroupSize(n, groups, g);
+            Node* leaf = pool.create(true);
+            for (size_t k = 0; k < count; k++, ++it) {
+                leaf->keys[k] = it->first;
+                leaf->data[k] = it->second;
+            }
+            leaf->keyCount = static_cast<int>(count);
+            leaf->prev = prev;
+            if (prev) prev->next = leaf;
+            prev = leaf;
+            level.push_back(leaf);
+            lowKeys.push_back(leaf->keys[0]);
+        }
+
+        // internal levels: a node with g children gets the low keys of children 1..g-1 as separators
+        while (level.size() > 1) {
+            size_t c = level.size();
+            size_t parents = bulkGroupCount(c, fill + 1, minKeys + 1);
+            vector<Node*> upper;
+            vector<Key> upperLows;
+            size_t child = 0;
+            for (size_t g = 0; g < parents; g++) {
+                size_t kids = bulkGroupSize(c, parents, g);
+                Node* node = pool.create(false);
+                upperLows.push_back(lowKeys[child]);
+                for (size_t k = 0; k < kids; k++, child++) {
+                    node->children[k] = level[child];
+                    node->counts[k] = subtreeCount(level[child]);
+                    if (k > 0) node->keys[k - 1] = lowKeys[child];
+                }
+                node->keyCount = static_cast<int>(kids - 1);
+                upper.push_back(node);
+            }
+            level.swap(upper);
+            lowKeys.swap(upperLows);
+        }
+        root = level[0];
+    }
+
+    // persistence: preorder dump, record pointers become ids relative to base; the leaf chain is
+    // rebuilt on load since leaves come back in left-to-right order
+    template <typename Record>
+    void serialize(ostream& out, const Record* base) const {
+        writePod(out, shape());
+        writePod<uint8_t>(out, root != nullptr);
+        if (root != nullptr) {
+            writeNode(out, root, base);
+        }
+    }
+
+    // replaces the current contents, false (and an empty tree) if the bytes are malformed
+    template <typename Record>
+    bool deserialize(ByteReader& in, Record* base, size_t recordCount) {
+        clear();
+        TreeShape stored{};
+        uint8_t hasRoot = 0;
+        if (!in.read(stored) || !(stored == shape()) || !in.read(hasRoot)) return false;
+        if (!hasRoot) return true;
+        Node* lastLeaf = nullptr;
+        root = readNode(in, base, recordCount, lastLeaf, 0);
+        if (root == nullptr) clear(); // drops whatever was read before the bad bytes
+        return root != nullptr;
+    }
+
+    void clear() {
+        pool.releaseAll();
+        root = nullptr;
+    }
+
+    ~BasicBPlus() { clear(); }
+
+private:
+    static TreeShape shape() { return TreeShape{sizeof(Key), sizeof(Value), static_cast<uint32_t>(Order)}; }
+
+    // depth-first search for the leaf slot of (key, record); copies of key can span several children,
+    // so every child from the first to the last one that may hold it is tried
+    bool findEntry(Node* node, const Key& key, const Value& record, vector<pair<Node*, int>>& path, Node*& leaf, int& pos) {
+        if (node->isLeaf) {
+            for (int i = findKeyIndex(node, key); i < node->keyCount && node->keys[i] == key; i++) {
+                if (node->data[i] == record) {
+                    leaf = node;
+                    pos = i;
+                    return true;
+                }
+            }
+            return false;
+        }
+        int hi = upperKeyIndex(node, key);
+        for (int i = findKeyIndex(node, key); i <= hi; i++) {
+            path.emplace_back(node, i);
+            if (findEntry(node->children[i], key, record, path, leaf, pos)) return true;
+            path.pop_back();
+        }
+        return false;
+    }
+
+    // children[idx] of parent is under minKeys: borrow from a sibling that can spare an entry,
+    // else merge with one. Leaves move entries and refresh the separator; internal nodes rotate
+    // through it.
+    void rebalanceChild(Node* parent, int idx) {
+        Node* child = parent->children[idx];
+        Node* left = idx > 0 ? parent->children[idx - 1] : nullptr;
+        Node* right = idx < parent->keyCount ? parent->children[idx + 1] : nullptr;
+        if (left != nullptr && left->keyCount > minKeys) {
+            for (int i = child->keyCount; i > 0; i--) {
+                child->keys[i] = child->keys[i - 1];
+                child->data[i] = child->data[i - 1];
+            }
+            if (child->isLeaf) {
+                child->keys[0] = left->keys[left->keyCount - 1];
+                child->data[0] = left->data[left->keyCount - 1];
+                parent->keys[idx - 1] = child->keys[0];
+            } else {
+                for (int i = child->keyCount + 1; i > 0; i--) {
+                    child->children[i] = child->children[i - 1];
+                    child->counts[i] = child->counts[i - 1];
+                }
+                child->keys[0] = parent->keys[idx - 1];
+                child->children[0] = left->children[left->keyCount];
+                child->counts[0] = left->counts[left->keyCount];
+                parent->keys[idx - 1] = left->keys[left->keyCount - 1];
+            }
+            child->keyCount++;
+            left->keyCount--;
+            parent->counts[idx - 1] = subtreeCount(left);
+            parent->counts[idx] = subtreeCount(child);
+        } else if (right != nullptr && right->keyCount > minKeys) {
+            if (child->isLeaf) {
+                child->keys[child->keyCount] = right->keys[0];
+                child->data[child->keyCount] = right->data[0];
+            } else {
+                child->keys[child->keyCount] = parent->keys[idx];
+                child->children[child->keyCount + 1] = right->children[0];
+                child->counts[child->keyCount + 1] = right->counts[0];
+                parent->keys[idx] = right->keys[0];
+            }
+            child->keyCount++;
+            for (int i = 0; i < right->keyCount - 1; i++) {
+                right->keys[i] = right->keys[i + 1];
+                right->data[i] = right->data[i + 1];
+            }
+            if (!right->isLeaf) {
+                for (int i = 0; i < right->keyCount; i++) {
+                    right->children[i] = right->children[i + 1];
+                    right->counts[i] = right->counts[i + 1];
+                }
+            }
+            right->keyCount--;
+            if (child->isLeaf) parent->keys[idx] = right->keys[0];
+            parent->counts[idx] = subtreeCount(child);
+            parent->counts[idx + 1] = subtreeCount(right);
+        } else {
+            mergeChildren(parent, left != nullptr ? idx - 1 : idx);
+        }
+    }
+
+    // folds children[sep+1] into children[sep]; internal nodes take the separator down with them,
+    // leaves just concatenate and unlink the right one from the chain
+    void mergeChildren(Node* parent, int sep) {
+        Node* a = parent->children[sep];
+        Node* b = parent->children[sep + 1];
+        if (a->isLeaf) {
+            for (int i = 0; i < b->keyCount; i++) {
+                a->keys[a->keyCount + i] = b->keys[i];
+                a->data[a->keyCount + i] = b->data[i];
+            }
+            a->keyCount += b->keyCount;
+            a->next = b->next;
+            if (b->next) b->next->prev = a;
+        } else {
+            a->keys[a->keyCount] = parent->keys[sep];
+            for (int i = 0; i < b->keyCount; i++) {
+                a->keys[a->keyCount + 1 + i] = b->keys[i];
+            }
+            for (int i = 0; i <= b->keyCount; i++) {
+                a->children[a->keyCount + 1 + i] = b->children[i];
+                a->counts[a->keyCount + 1 + i] = b->counts[i];
+            }
+            a->keyCount += 1 + b->keyCount;
+        }
+        for (int i = sep; i < parent->keyCount - 1; i++) {
+            parent->keys[i] = parent->keys[i + 1];
+        }
+        for (int i = sep + 1; i < parent->keyCount; i++) {
+            parent->children[i] = parent->children[i + 1];
+            parent->counts[i] = parent->counts[i + 1];
+        }
+        parent->counts[sep] = subtreeCount(a);
+        parent->keyCount--;
+        pool.destroy(b);
+    }
+
+    static uint32_t subtreeCount(const Node* node) {
+        if (node->isLeaf) return static_cast<uint32_t>(node->keyCount);
+        uint32_t total = 0;
+        for (int i = 0; i <= node->keyCount; i++) total += node->counts[i];
+        return total;
+    }
+    // entries with a key below key (orEqual: at most key). Children left of the one the walk takes
+    // hold only smaller keys and are counted whole, the ones right of it only larger keys
+    size_t countBelow(const Key& key, bool orEqual) {
+        size_t below = 0;
+        Node* node = root;
+        while (node != nullptr && !node->isLeaf) {
+            int i = orEqual ? upperKeyIndex(node, key) : findKeyIndex(node, key);
+            for (int k = 0; k < i; k++) below += node->counts[k];
+            node = node->children[i];
+        }
+        if (node != nullptr) below += orEqual ? upperKeyIndex(node, key) : findKeyIndex(node, key);
+        return below;
+    }
+
+    // how many nodes to split c entries into: as few as full allows, but never so many that a
+    // non-root node gets fewer than least entries
+    static size_t bulkGroupCount(size_t c, size_t full, size_t least) {
+        size_t groups = (c + full - 1) / full;
+        if (groups > 1) {
+            groups = min(groups, c / least);
+        }
+        return max<size_t>(groups, 1);
+    }
+    static size_t bulkGroupSize(size_t c, size_t groups, size_t g) {
+        return c / groups + (g < c % groups ? 1 : 0);
+    }
+
+    template <typename Record>
+    void writeNode(ostream& out, const Node* node, const Record* base) const {
+        writePod<uint8_t>(out, node->isLeaf);
+        writePod<int32_t>(out, node->keyCount);
+        writePods(out, node->keys, node->keyCount);
+        if (node->isLeaf) {
+            writeValues(out, node->data, node->keyCount, base);
+        } else {
+            for (int i = 0; i <= node->keyCount; i++) {
+                writeNode(out, node->children[i], base);
+            }
+        }
+    }
+
+    template <typename Record>
+    Node* readNode(ByteReader& in, Record* base, size_t recordCount, Node*& lastLeaf, int depth) {
+        uint8_t leaf = 0;
+        int32_t n = 0;
+        if (depth > 64 || !in.read(leaf) || !in.read(n) || n < 0 || n > maxKeys) return nullptr;
+        Node* node = pool.create(leaf != 0);
+        node->keyCount = n;
+        bool ok = in.readN(node->keys, n);
+        if (ok && node->isLeaf) {
+            ok = readValues(in, node->data, n, base, recordCount);
+            if (ok) {
+                if (lastLeaf) lastLeaf->next = node;
+                node->prev = lastLeaf;
+                lastLeaf = node;
+            }
+        }
+        for (int i = 0; ok && !node->isLeaf && i <= n; i++) {
+            node->children[i] = readNode(in, base, recordCount, lastLeaf, depth + 1);
+            ok = node->children[i] != nullptr;
+            if (ok) node->counts[i] = subtreeCount(node->children[i]); // derived, so not stored in the file
+        }
+        return ok ? node : nullptr; // partial nodes stay in the pool until the caller clears it
+    }
+
+public:
+    // read mem for ui: what the node slabs actually take, unused slab space included
+    size_t approxBytes() const { return pool.bytesReserved(); }
+};
+
 #endif //BPLUSTREE_BPLUS_H
\ No newline at end of file
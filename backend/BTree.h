@@ -1,77 +1,95 @@
+#ifndef BTREE_H
+#define BTREE_H
+#include <algorithm>
+#include <cstdint>
 #include <iostream>
+#include <iterator>
 #include <string>
+#include <string_view>
 #include <vector>
-#include <queue>
+#include <utility>
+#include "KeySearch.h"
+#include "NodePool.h"
+#include "Serialize.h"
+// text fields point into the file the record was loaded from (the mapped snapshot or CSV), which
+// stays mapped for as long as the records are used
 struct MarketRecord {
-    std::string timestamp;
-    std::string name;
-    std::string symbol;
+    std::string_view timestamp;
+    std::string_view name;
+    std::string_view symbol;
     double price;
     double high;
     double low;
     double volume;
-    std::string type;
-    MarketRecord(std::string timestamp, std::string name, std::string symbol, double price, double high, double low, double volume, std::string type) : timestamp(timestamp), name(name), symbol(symbol), price(price), high(high), low(low), volume(volume), type(type) {}
+    std::string_view type;
+    int64_t epochMs = 0; // parsed once from timestamp at ingest (UTC milliseconds), reused by every index and scan
+    int64_t priceTicks = 0; // price in fixed-point cents, parsed from the CSV text (no double round trip)
+    uint32_t nameId = 0; // dense ids from the asset catalog, assigned once everything is loaded
+    uint32_t symbolId = 0;
+    MarketRecord(std::string_view timestamp, std::string_view name, std::string_view symbol, double price, double high, double low, double volume, std::string_view type) : timestamp(timestamp), name(name), symbol(symbol), price(price), high(high), low(low), volume(volume), type(type) {}
 };
-struct TreeNode {
-    static const int order = 5; 
+// fanout (order) is a template parameter so node size can be tuned; nodes start on a cache line
+template <typename Key, typename Value, int Order>
+struct alignas(64) BTreeNode {
+    static const int order = Order;
     int numKeys;
-    int keys[(2*order)-1];
-    TreeNode* children[(2*order)];
     bool leaf;
-    MarketRecord* data[(2*order)-1];
-    TreeNode(bool leaf = false) {
+    Key keys[(2*order)-1];
+    Value data[(2*order)-1];
+    BTreeNode* children[(2*order)];
+    uint32_t counts[(2*order)]; // internal nodes: how many entries sit under each child
+    BTreeNode(bool leaf = false) {
         this->leaf = leaf;
         numKeys = 0;
         for (int i = 0; i < (2*order)-1; i++) {
-            keys[i] = 0;
-            data[i] = nullptr;
+            keys[i] = Key();
+            data[i] = Value();
         }
         for(int i = 0; i < (2*order); i++) {
             children[i] = nullptr;
+            counts[i] = 0;
         }
     }
 };
-class MyBTree {
+
+// largest order whose node fits in the given bytes (64 = one cache line, 4096 = a page)
+template <typename Key, typename Value>
+constexpr int btreeOrderForBytes(size_t bytes) {
+    int o = 2;
+    auto nodeBytes = [](int order) {
+        return 8 + (2 * order - 1) * (sizeof(Key) + sizeof(Value)) + 2 * order * (sizeof(void*) + sizeof(uint32_t));
+    };
+    while (nodeBytes(o + 1) <= bytes) o++;
+    return o;
+}
+
+template <typename Key, typename Value, int Order = 5>
+class BasicBTree {
+public:
+    using key_type = Key;
+    using value_type = Value;
+private:
+    using TreeNode = BTreeNode<Key, Value, Order>;
+    NodePool<TreeNode> pool; // every node lives here, clear() drops them all at once
     TreeNode* root = nullptr; 
-    static const int order = 5; // set same order here as in treenode
+    static const int order = Order;
     static const int minKeys = order-1; 
     static const int maxKeys = 2*order-1;
-    MarketRecord* searchHelp(TreeNode* node, int key) { 
+    Value searchHelp(TreeNode* node, const Key& key) { 
         int i = findKeyIndex(node, key); 
 
         if(i < node->numKeys && node->keys[i] == key) { 
             return node->data[i];
         }
         if(node->leaf) { 
-            return nullptr;
+            return Value();
         }
         if(node->children[i] != nullptr) { 
             return searchHelp(node->children[i], key);
         }    
-        return nullptr; 
+        return Value(); 
     }  
-    void rangeQueryHelp(TreeNode* node, int key1, int key2, std::vector<MarketRecord*>& results) {
-        if(node == nullptr) {// nothing here
-            return;
-        }
-        int i = findKeyIndex(node, key1); 
-        int j = findKeyIndex(node, key2);
-        for(int k = i; k <= j && k < node->numKeys; k++) { // adds everything between key1 and key2
-            if(node->data[k] != nullptr && node->keys[k] <= key2 && node->keys[k] >= key1) {
-            results.push_back(node->data[k]);
-            }
-        }
-        if(node->leaf) {
-            return; 
-        }
-        for(int k = i; k <= j && k < node->numKeys+1; k++) { // goes through children between key1 and key2
-            if(node->children[k] != nullptr) { 
-            rangeQueryHelp(node->children[k], key1, key2, results);
-            }
-        }
-    }
-    void insertHelp(TreeNode* node, int key, MarketRecord* data) { 
+    void insertHelp(TreeNode* node, const Key& key, const Value& data) { 
         if(node->leaf) { 
             int i = findKeyIndex(node, key); 
             for(int j = node->numKeys-1; j >= i; j--) { 
@@ -89,12 +107,13 @@ class MyBTree {
                     i++;
                 }
             }
+            node->counts[i]++;
             insertHelp(node->children[i], key, data); 
         }
     }
     void splitChild(TreeNode* node, int index) { 
         TreeNode* child = node->children[index]; 
-        TreeNode* newNode = new TreeNode(child->leaf); 
+        TreeNode* newNode = pool.create(child->leaf); 
         newNode->numKeys = minKeys; 
         for(int i = 0; i < minKeys; i++) { 
             newNode->keys[i] = child->keys[i+order]; 
@@ -103,12 +122,13 @@ class MyBTree {
         if(!child->leaf) { 
             for(int i = 0; i < order; i++) {
                 newNode->children[i] = child->children[i+order];
-
+                newNode->counts[i] = child->counts[i+order];
             }
         }
         child->numKeys = minKeys; 
         for(int i = node->numKeys; i >= index+1; i--) { // shifts children to the right
             node->children[i+1] = node->children[i];
+            node->counts[i+1] = node->counts[i];
         }
         node->children[index+1] = newNode; // inserts new node into parent
         for(int i = node->numKeys-1; i >= index; i--) { 
@@ -118,41 +138,293 @@ class MyBTree {
         node->keys[index] = child->keys[minKeys]; 
         node->data[index] = child->data[minKeys];
         node->numKeys++;
+        node->counts[index] = subtreeCount(child);
+        node->counts[index+1] = subtreeCount(newNode);
+    }
+    static uint32_t subtreeCount(const TreeNode* node) {
+        uint32_t total = static_cast<uint32_t>(node->numKeys);
+        if(!node->leaf) {
+            for(int i = 0; i <= node->numKeys; i++) {
+                total += node->counts[i];
+            }
+        }
+        return total;
+    }
+    // entries with a key below key (orEqual: at most key). The keys left of the child the walk takes
+    // and the subtrees under them are all smaller and counted whole; everything right of it is larger
+    size_t countBelow(const Key& key, bool orEqual) {
+        size_t below = 0;
+        for(TreeNode* node = root; node != nullptr; ) {
+            int i = orEqual ? upperKeyIndex(node, key) : findKeyIndex(node, key);
+            below += i;
+            if(node->leaf) {
+                break;
+            }
+            for(int k = 0; k < i; k++) {
+                below += node->counts[k];
+            }
+            node = node->children[i];
+        }
+        return below;
+    }
+    // depth-first search for (key, data); copies of key can sit in several children and separators,
+    // so every child and key from the first to the last one that may hold it is tried. path gets the
+    // (node, child taken) pairs from the root down to the node holding the entry.
+    bool findEntry(TreeNode* node, const Key& key, const Value& data, std::vector<std::pair<TreeNode*, int>>& path, int& pos) {
+        int lo = findKeyIndex(node, key);
+        int hi = upperKeyIndex(node, key);
+        for(int i = lo; i <= hi; i++) {
+            if(!node->leaf) {
+                path.emplace_back(node, i);
+                if(findEntry(node->children[i], key, data, path, pos)) {
+                    return true;
+                }
+                path.pop_back();
+            }
+            if(i < hi && node->data[i] == data) {
+                path.emplace_back(node, i);
+                pos = i;
+                return true;
+            }
+        }
+        return false;
+    }
+    // children[idx] is under minKeys: rotate a key in through the separator from a sibling that can
+    // spare one, else merge with a sibling
+    void rebalanceChild(TreeNode* parent, int idx) {
+        TreeNode* child = parent->children[idx];
+        TreeNode* left = idx > 0 ? parent->children[idx-1] : nullptr;
+        TreeNode* right = idx < parent->numKeys ? parent->children[idx+1] : nullptr;
+        if(left != nullptr && left->numKeys > minKeys) {
+            for(int i = child->numKeys; i > 0; i--) {
+                child->keys[i] = child->keys[i-1];
+                child->data[i] = child->data[i-1];
+            }
+            if(!child->leaf) {
+                for(int i = child->numKeys+1; i > 0; i--) {
+                    child->children[i] = child->children[i-1];
+                    child->counts[i] = child->counts[i-1];
+                }
+                child->children[0] = left->children[left->numKeys];
+                child->counts[0] = left->counts[left->numKeys];
+            }
+            child->keys[0] = parent->keys[idx-1];
+            child->data[0] = parent->data[idx-1];
+            parent->keys[idx-1] = left->keys[left->numKeys-1];
+            parent->data[idx-1] = left->data[left->numKeys-1];
+            child->numKeys++;
+            left->numKeys--;
+            parent->counts[idx-1] = subtreeCount(left);
+            parent->counts[idx] = subtreeCount(child);
+        } else if(right != nullptr && right->numKeys > minKeys) {
+            child->keys[child->numKeys] = parent->keys[idx];
+            child->data[child->numKeys] = parent->data[idx];
+            if(!child->leaf) {
+                child->children[child->numKeys+1] = right->children[0];
+                child->counts[child->numKeys+1] = right->counts[0];
+                for(int i = 0; i < right->numKeys; i++) {
+                    right->children[i] = right->children[i+1];
+                    right->counts[i] = right->counts[i+1];
+                }
+            }
+            child->numKeys++;
+            parent->keys[idx] = right->keys[0];
+            parent->data[idx] = right->data[0];
+            for(int i = 0; i < right->numKeys-1; i++) {
+                right->keys[i] = right->keys[i+1];
+                right->data[i] = right->data[i+1];
+            }
+            right->numKeys--;
+            parent->counts[idx] = subtreeCount(child);
+            parent->counts[idx+1] = subtreeCount(right);
+        } else {
+            mergeChildren(parent, left != nullptr ? idx-1 : idx);
+        }
+    }
+    // folds the separator and children[sep+1] into children[sep]; both are at minKeys or less, so
+    // the result fits
+    void mergeChildren(TreeNode* parent, int sep) {
+        TreeNode* a = parent->children[sep];
+        TreeNode* b = parent->children[sep+1];
+        a->keys[a->numKeys] = parent->keys[sep];
+        a->data[a->numKeys] = parent->data[sep];
+        for(int i = 0; i < b->numKeys; i++) {
+            a->keys[a->numKeys+1+i] = b->keys[i];
+            a->data[a->numKeys+1+i] = b->data[i];
+        }
+        if(!a->leaf) {
+            for(int i = 0; i <= b->numKeys; i++) {
+                a->children[a->numKeys+1+i] = b->children[i];
+                a->counts[a->numKeys+1+i] = b->counts[i];
+            }
+        }
+        a->numKeys += 1 + b->numKeys;
+        for(int i = sep; i < parent->numKeys-1; i++) {
+            parent->keys[i] = parent->keys[i+1];
+            parent->data[i] = parent->data[i+1];
+        }
+        for(int i = sep+1; i < parent->numKeys; i++) {
+            parent->children[i] = parent->children[i+1];
+            parent->counts[i] = parent->counts[i+1];
+        }
+        parent->numKeys--;
+        parent->counts[sep] = subtreeCount(a);
+        pool.destroy(b);
     }
 
     public:
-    int findKeyIndex(TreeNode* node, int key) { // find the index of the key in the node (makes it easier to insert and search)
-        int i = 0;
-        while(i < node->numKeys && key > node->keys[i]) { 
-            i++;
-        }
-        return i;
+    int findKeyIndex(TreeNode* node, const Key& key) { // find the index of the key in the node (makes it easier to insert and search)
+        return keysearch::lowerIndex(node->keys, node->numKeys, key);
     }   
-    MarketRecord* search(int key) { 
+    int upperKeyIndex(TreeNode* node, const Key& key) { // first index whose key is greater than key
+        return keysearch::upperIndex(node->keys, node->numKeys, key);
+    }
+    Value search(const Key& key) { // Value() when the key is absent
         if(root == nullptr) {
-            return nullptr;
+            return Value();
         }
         return searchHelp(root, key); 
     }
 
-    std::vector<MarketRecord*> rangeQuery(int key1, int key2) {
-        std::vector<MarketRecord*> results;
-        if(root == nullptr) {
-            return results;
+    // in-order cursor over the entries with keys in [low, high]: it walks down to the first key >= low
+    // and keeps that path on a stack, so the range is read one entry at a time in key order and can
+    // be abandoned early. Valid until the tree is next modified.
+    class Cursor {
+    public:
+        bool valid() const { return !path.empty(); }
+        const Key& key() const { return path.back().first->keys[path.back().second]; }
+        const Value& value() const { return path.back().first->data[path.back().second]; }
+        void next() {
+            std::pair<TreeNode*, int>& top = path.back();
+            TreeNode* node = top.first;
+            int i = ++top.second;
+            if(node->leaf) {
+                if(i < node->numKeys) { // the common step, along a leaf
+                    if(high < node->keys[i]) {
+                        path.clear();
+                    }
+                    return;
+                }
+            } else { // after key i-1 comes the smallest entry of the subtree right of it
+                descendLeft(node->children[i]);
+            }
+            settle();
+        }
+    private:
+        friend class BasicBTree;
+        std::vector<std::pair<TreeNode*, int>> path; // (node, index of the next key to visit in it)
+        Key high{};
+        void descendLeft(TreeNode* node) {
+            for(; node != nullptr; node = node->leaf ? nullptr : node->children[0]) {
+                path.emplace_back(node, 0);
+            }
+        }
+        void settle() { // pops finished nodes, then stops for good once past high
+            while(!path.empty() && path.back().second >= path.back().first->numKeys) {
+                path.pop_back();
+            }
+            if(!path.empty() && high < key()) {
+                path.clear();
+            }
+        }
+    };
+    // the same range from the largest key down: the stack holds how many keys of each node are still
+    // to the left, and after a key comes the rightmost entry of the subtree just below it
+    class ReverseCursor {
+    public:
+        bool valid() const { return !path.empty(); }
+        const Key& key() const { return path.back().first->keys[path.back().second-1]; }
+        const Value& value() const { return path.back().first->data[path.back().second-1]; }
+        void next() {
+            std::pair<TreeNode*, int>& top = path.back();
+            TreeNode* node = top.first;
+            int i = --top.second;
+            if(node->leaf) {
+                if(i > 0) { // the common step, along a leaf
+                    if(node->keys[i-1] < low) {
+                        path.clear();
+                    }
+                    return;
+                }
+            } else {
+                descendRight(node->children[i]);
+            }
+            settle();
+        }
+    private:
+        friend class BasicBTree;
+        std::vector<std::pair<TreeNode*, int>> path; // (node, keys of it still to visit, the last first)
+        Key low{};
+        void descendRight(TreeNode* node) {
+            for(; node != nullptr; node = node->leaf ? nullptr : node->children[node->numKeys]) {
+                path.emplace_back(node, node->numKeys);
+            }
+        }
+        void settle() {
+            while(!path.empty() && path.back().second == 0) {
+                path.pop_back();
+            }
+            if(!path.empty() && key() < low) {
+                path.clear();
+            }
+        }
+    };
+    Cursor cursor(const Key& low, const Key& high) {
+        Cursor c;
+        c.high = high;
+        // keys left of the first key >= low are smaller, and so is everything under them
+        for(TreeNode* node = root; node != nullptr; node = node->leaf ? nullptr : node->children[c.path.back().second]) {
+            c.path.emplace_back(node, findKeyIndex(node, low));
+        }
+        c.settle();
+        return c;
+    }
+    ReverseCursor reverseCursor(const Key& low, const Key& high) {
+        ReverseCursor c;
+        c.low = low;
+        // keys right of the last key <= high are larger, and so is everything under them
+        for(TreeNode* node = root; node != nullptr; node = node->leaf ? nullptr : node->children[c.path.back().second]) {
+            c.path.emplace_back(node, upperKeyIndex(node, high));
+        }
+        c.settle();
+        return c;
+    }
+
+    // in key order; skips the first offset matches and stops after limit, so a page of a wide range
+    // only walks as far as it needs
+    std::vector<Value> rangeQuery(const Key& key1, const Key& key2, size_t limit = SIZE_MAX, size_t offset = 0) {
+        std::vector<Value> results;
+        Cursor c = cursor(key1, key2);
+        for(; c.valid() && offset > 0; c.next()) {
+            offset--;
+        }
+        for(; c.valid() && results.size() < limit; c.next()) {
+            results.push_back(c.value());
+        }
+        return results;
+    }
+    // same page counted from the top of the range, largest key first
+    std::vector<Value> reverseRangeQuery(const Key& key1, const Key& key2, size_t limit = SIZE_MAX, size_t offset = 0) {
+        std::vector<Value> results;
+        ReverseCursor c = reverseCursor(key1, key2);
+        for(; c.valid() && offset > 0; c.next()) {
+            offset--;
+        }
+        for(; c.valid() && results.size() < limit; c.next()) {
+            results.push_back(c.value());
         }
-        rangeQueryHelp(root, key1, key2, results);
         return results;
     }
 
-    void insert(int key, MarketRecord* data) {
+    void insert(const Key& key, const Value& data) {
         if(root == nullptr) { 
-            root = new TreeNode(true);
+            root = pool.create(true);
             root->keys[0] = key;
             root->data[0] = data;
             root->numKeys = 1;
         } else { 
             if(root->numKeys == maxKeys) {
-                TreeNode* newRoot = new TreeNode(false);
+                TreeNode* newRoot = pool.create(false);
                 newRoot->children[0] = root;
                 root = newRoot;
                 splitChild(root, 0); // splits root node if it has max keys
@@ -160,38 +432,225 @@ class MyBTree {
                 insertHelp(root, key, data); 
         }
     }
-    MyBTree() {
-        root = nullptr;
+    // entries with keys in [key1, key2] from the per-child counts: one root-to-leaf walk for each end,
+    // whatever the width of the range
+    size_t countRange(const Key& key1, const Key& key2) {
+        if(key2 < key1) {
+            return 0;
+        }
+        return countBelow(key2, true) - countBelow(key1, false);
     }
-    ~MyBTree() { // need a destructor to free memory
-        std::queue<TreeNode*> q; // using a queue for breadth-first traversal to delete nodes
-        if(root != nullptr) {
-            q.push(root);
-        }
-        while(!q.empty()) {
-            TreeNode* curr = q.front();
-            q.pop();
-            if(!curr->leaf) {
-                for(int i = 0; i < curr->numKeys+1; i++) {
-                    if(curr->children[i] != nullptr) {
-                        q.push(curr->children[i]);
+    size_t size() const {
+        return root == nullptr ? 0 : subtreeCount(root);
+    }
+    // removes the entry with this key and data (keys can repeat, the data says which one), false if
+    // there is none. An entry in an internal node is swapped with its predecessor first, so removal
+    // always happens in a leaf; underfull nodes then borrow or merge on the way back up.
+    bool erase(const Key& key, const Value& data) {
+        std::vector<std::pair<TreeNode*, int>> path;
+        int pos = -1;
+        if(root == nullptr || !findEntry(root, key, data, path, pos)) {
+            return false;
+        }
+        TreeNode* node = path.back().first;
+        path.pop_back();
+        if(!node->leaf) { // predecessor: rightmost entry of the subtree left of pos
+            TreeNode* holder = node;
+            path.emplace_back(node, pos);
+            node = node->children[pos];
+            while(!node->leaf) {
+                path.emplace_back(node, node->numKeys);
+                node = node->children[node->numKeys];
+            }
+            holder->keys[pos] = node->keys[node->numKeys-1];
+            holder->data[pos] = node->data[node->numKeys-1];
+            pos = node->numKeys-1;
+        }
+        for(int i = pos; i < node->numKeys-1; i++) {
+            node->keys[i] = node->keys[i+1];
+            node->data[i] = node->data[i+1];
+        }
+        node->numKeys--;
+        for(auto& step : path) {
+            step.first->counts[step.second]--;
+        }
+
+        while(!path.empty() && node->numKeys < minKeys) {
+            TreeNode* parent = path.back().first;
+            int idx = path.back().second;
+            path.pop_back();
+            rebalanceChild(parent, idx);
+            node = parent;
+        }
+        if(root->numKeys == 0) { // an empty leaf root means an empty tree, an internal one a level less
+            TreeNode* old = root;
+            root = root->leaf ? nullptr : root->children[0];
+            pool.destroy(old);
+        }
+        return true;
+    }
+    // moves an entry to a new key (a corrected price), false if it was not there
+    bool update(const Key& oldKey, const Key& newKey, const Value& data) {
+        if(!erase(oldKey, data)) {
+            return false;
+        }
+        insert(newKey, data);
+        return true;
+    }
+    // calls f(key, value) on every entry with a key in [low, high], in key order; f may change the
+    // value in place (the keys, and so the shape of the tree, stay as they are)
+    template <typename F>
+    void updateValues(const Key& low, const Key& high, F f) {
+        for(Cursor c = cursor(low, high); c.valid(); c.next()) {
+            f(c.key(), c.path.back().first->data[c.path.back().second]);
+        }
+    }
+    // builds the tree bottom-up from entries already sorted by key (pairs of key, value), replacing
+    // the current contents. fillFactor is how full each node is packed; 1.0 gives the smallest tree,
+    // lower values leave room for later inserts. Nodes never drop below minKeys (except the root).
+    template <typename It>
+    void bulkLoad(It first, It last, double fillFactor = 1.0) {
+        clear();
+        size_t n = static_cast<size_t>(std::distance(first, last));
+        if(n == 0) return;
+        const int lo = minKeys, hi = maxKeys; // copies, std::min/max take references
+        int fill = std::max(lo, std::min(hi, static_cast<int>(hi * fillFactor + 0.5)));
+
+        // a node with k keys is followed by one separator that moves up a level, so n keys form n+1
+        // "slots" and each leaf takes k+1 of them (the last leaf's extra slot is imaginary)
+        std::vector<TreeNode*> level;
+        std::vector<std::pair<Key, Value>> seps;
+        size_t groups = bulkGroupCount(n + 1, fill + 1);
+        pool.reserve(groups + groups / (order - 1) + 1); // leaves plus a bound on the levels above
+        It it = first;
+        for(size_t g = 0; g < groups; g++) {
+            size_t keys = bulkGroupSize(n + 1, groups, g) - 1;
+            TreeNode* leaf = pool.create(true);
+            for(size_t k = 0; k < keys; k++, ++it) {
+                leaf->keys[k] = it->first;
+                leaf->data[k] = it->second;
+            }
+            leaf->numKeys = static_cast<int>(keys);
+            level.push_back(leaf);
+            if(g + 1 < groups) {
+                seps.emplace_back(it->first, it->second);
+                ++it;
+            }
+        }
+
+        // same packing one level up: c children need c-1 separators, a node with g children takes g-1
+        while(level.size() > 1) {
+            size_t c = level.size();
+            size_t parents = bulkGroupCount(c, fill + 1);
+            std::vector<TreeNode*> upper;
+            std::vector<std::pair<Key, Value>> upperSeps;
+            size_t child = 0, sep = 0;
+            for(size_t g = 0; g < parents; g++) {
+                size_t kids = bulkGroupSize(c, parents, g);
+                TreeNode* node = pool.create(false);
+                for(size_t k = 0; k < kids; k++) {
+                    node->counts[k] = subtreeCount(level[child]);
+                    node->children[k] = level[child++];
+                    if(k + 1 < kids) {
+                        node->keys[k] = seps[sep].first;
+                        node->data[k] = seps[sep].second;
+                        sep++;
                     }
                 }
-            delete curr;
+                node->numKeys = static_cast<int>(kids - 1);
+                upper.push_back(node);
+                if(g + 1 < parents) {
+                    upperSeps.push_back(seps[sep++]);
+                }
             }
+            level.swap(upper);
+            seps.swap(upperSeps);
         }
+        root = level[0];
+    }
+
+    BasicBTree() {
+        root = nullptr;
+    }
+    BasicBTree(const BasicBTree&) = delete; // owns its nodes
+    BasicBTree& operator=(const BasicBTree&) = delete;
+    ~BasicBTree() { // need a destructor to free memory
+        clear();
+    }
+    void clear() {
+        pool.releaseAll();
+        root = nullptr;
+    }
+
+    // persistence: nodes are written in preorder, record pointers become ids relative to base
+    template <typename Record>
+    void serialize(std::ostream& out, const Record* base) const {
+        writePod(out, shape());
+        writePod<uint8_t>(out, root != nullptr);
+        if(root != nullptr) {
+            writeNode(out, root, base);
+        }
+    }
+    // replaces the current contents, false (and an empty tree) if the bytes are malformed
+    template <typename Record>
+    bool deserialize(ByteReader& in, Record* base, size_t recordCount) {
+        clear();
+        TreeShape stored{};
+        uint8_t hasRoot = 0;
+        if(!in.read(stored) || !(stored == shape()) || !in.read(hasRoot)) return false;
+        if(!hasRoot) return true;
+        root = readNode(in, base, recordCount, 0);
+        if(root == nullptr) clear(); // drops whatever was read before the bad bytes
+        return root != nullptr;
     }
-    //read mem for ui
 private:
-    size_t countNodes(TreeNode* n) const {
-        if (!n) return 0;
-        size_t c = 1;
-        if (!n->leaf) {
-            for (int i = 0; i <= n->numKeys; ++i)
-                c += countNodes(n->children[i]);
+    static TreeShape shape() { return TreeShape{sizeof(Key), sizeof(Value), static_cast<uint32_t>(Order)}; }
+
+    // how many nodes to split c slots into: as few as the fill allows, but never so many that a
+    // non-root node would end up under minKeys
+    static size_t bulkGroupCount(size_t c, size_t full) {
+        size_t groups = (c + full - 1) / full;
+        if(groups > 1) {
+            groups = std::min(groups, c / (minKeys + 1));
+        }
+        return std::max<size_t>(groups, 1);
+    }
+    static size_t bulkGroupSize(size_t c, size_t groups, size_t g) { // spreads the remainder over the first groups
+        return c / groups + (g < c % groups ? 1 : 0);
+    }
+
+    template <typename Record>
+    void writeNode(std::ostream& out, const TreeNode* node, const Record* base) const {
+        writePod<uint8_t>(out, node->leaf);
+        writePod<int32_t>(out, node->numKeys);
+        writePods(out, node->keys, node->numKeys);
+        writeValues(out, node->data, node->numKeys, base);
+        if(!node->leaf) {
+            for(int i = 0; i <= node->numKeys; i++) {
+                writeNode(out, node->children[i], base);
+            }
         }
-        return c;
+    }
+    template <typename Record>
+    TreeNode* readNode(ByteReader& in, Record* base, size_t recordCount, int depth) {
+        uint8_t leaf = 0;
+        int32_t n = 0;
+        if(depth > 64 || !in.read(leaf) || !in.read(n) || n < 0 || n > maxKeys) return nullptr;
+        TreeNode* node = pool.create(leaf != 0);
+        node->numKeys = n;
+        bool ok = in.readN(node->keys, n) && readValues(in, node->data, n, base, recordCount);
+        for(int i = 0; ok && !node->leaf && i <= n; i++) {
+            node->children[i] = readNode(in, base, recordCount, depth + 1);
+            ok = node->children[i] != nullptr;
+            if(ok) {
+                node->counts[i] = subtreeCount(node->children[i]); // derived, so not stored in the file
+            }
+        }
+        return ok ? node : nullptr; // partial nodes stay in the pool until the caller clears it
     }
 public:
-    size_t approxBytes() const { return countNodes(root) * sizeof(TreeNode); }
+    //read mem for ui: what the node slabs actually take, unused slab space included
+    size_t approxBytes() const { return pool.bytesReserved(); }
 };
+
+#endif //BTREE_H
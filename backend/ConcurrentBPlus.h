@@ -0,0 +1,543 @@
+#ifndef CONCURRENTBPLUS_H
+#define CONCURRENTBPLUS_H
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <iterator>
+#include <mutex>
+#include <vector>
+#include "NodePool.h"
+
+// B+ tree that writers can change while any number of readers query it, using optimistic lock
+// coupling. Every node carries a version word: odd while a writer holds the node, bumped by 2 each
+// time the writer lets go. Readers take no latches and write nothing shared; they note a node's
+// version, read the node, and keep what they read only if the version is unchanged (otherwise they
+// read it again). Writers latch a node only to change it: a leaf to add or drop an entry, and a
+// node plus its parent to split it. Full nodes are split on the way down, so a split never has to
+// climb further up. Every field a reader can see is atomic; the version word orders them.
+//
+// A split only moves entries into a new right sibling, so a scan that already passed a leaf never
+// sees its entries again. An erase just takes the entry out of its leaf (leaves can end up empty,
+// nothing is merged), so nodes are never freed while the tree is in use and a reader holding a
+// stale pointer still reads valid memory and simply fails validation. Scans read each leaf
+// consistently; entries inserted behind a scan while it runs are not seen. bulkLoad and clear
+// need the tree to themselves.
+template <typename Key, typename Value, int Order>
+struct alignas(64) OlcNode {
+    static const int order = Order;
+    std::atomic<uint64_t> version{0};
+    const bool isLeaf;
+    std::atomic<int> keyCount{0};
+    std::atomic<Key> keys[order-1];
+    std::atomic<Value> data[order-1];
+    std::atomic<OlcNode*> children[order];
+    std::atomic<OlcNode*> next{nullptr}; // leaves are linked both ways, like BPlusNode
+    std::atomic<OlcNode*> prev{nullptr};
+
+    explicit OlcNode(bool leaf = false) : isLeaf(leaf) {
+        for (int i = 0; i < order-1; i++) {
+            keys[i].store(Key(), std::memory_order_relaxed);
+            data[i].store(Value(), std::memory_order_relaxed);
+        }
+        for (int i = 0; i < order; i++) {
+            children[i].store(nullptr, std::memory_order_relaxed);
+        }
+    }
+};
+
+template <typename Key, typename Value, int Order = 5>
+class ConcurrentBPlus {
+    static_assert(std::atomic<Key>::is_always_lock_free && std::atomic<Value>::is_always_lock_free,
+                  "keys and values are read while writers change them, they have to fit a lock-free atomic");
+    // an eager split of a full internal node must leave a key on each side
+    static_assert(Order >= 4, "B+ tree nodes need room for at least 3 keys");
+    using Node = OlcNode<Key, Value, Order>;
+    static constexpr int maxKeys = Order-1;
+
+    // one leaf as it was at a single version: what cursors and scans work from
+    struct LeafCopy {
+        Node* node = nullptr;
+        int keyCount = 0;
+        Key keys[maxKeys];
+        Value data[maxKeys];
+        Node* next = nullptr;
+        Node* prev = nullptr;
+    };
+
+public:
+    using key_type = Key;
+    using value_type = Value;
+
+    ConcurrentBPlus() { root.store(newNode(true), std::memory_order_release); }
+    ConcurrentBPlus(const ConcurrentBPlus&) = delete; // owns its nodes
+    ConcurrentBPlus& operator=(const ConcurrentBPlus&) = delete;
+
+    // CURSOR - forward over the entries with keys in [low, high], a leaf copy at a time along the
+    // next chain. Stays valid while writers run; it sees each leaf as it was when it got there.
+    class Cursor {
+    public:
+        bool valid() const { return leaf.node != nullptr; }
+        const Key& key() const { return leaf.keys[pos]; }
+        const Value& value() const { return leaf.data[pos]; }
+        void next() {
+            pos++;
+            settle();
+        }
+    private:
+        friend class ConcurrentBPlus;
+        LeafCopy leaf;
+        int pos = 0;
+        Key low{}, high{};
+        // moves to the next leaf at the end of this one, then stops for good once past high. The
+        // first leaf can split between the walk down and the copy, so the next one can still
+        // start below low.
+        void settle() {
+            while (leaf.node != nullptr && pos >= leaf.keyCount) {
+                Node* next = leaf.next;
+                leaf.node = nullptr;
+                if (next != nullptr) readLeaf(next, leaf);
+                pos = lowerIndex(leaf.keys, leaf.keyCount, low);
+            }
+            if (leaf.node != nullptr && high < leaf.keys[pos]) leaf.node = nullptr;
+        }
+    };
+    Cursor cursor(const Key& low, const Key& high) const {
+        Cursor c;
+        c.low = low;
+        c.high = high;
+        readLeaf(findLeaf(low, false), c.leaf); // left on equal keys: copies of a separator can end the left leaf
+        c.pos = lowerIndex(c.leaf.keys, c.leaf.keyCount, low);
+        c.settle();
+        return c;
+    }
+
+    // REVERSE CURSOR - the same range from the largest key down, along the prev chain. A prev link
+    // can lag a split of the leaf it points at; the walk then goes forward from there to the leaf
+    // right before this one.
+    class ReverseCursor {
+    public:
+        bool valid() const { return leaf.node != nullptr; }
+        const Key& key() const { return leaf.keys[pos]; }
+        const Value& value() const { return leaf.data[pos]; }
+        void next() {
+            pos--;
+            settle();
+        }
+    private:
+        friend class ConcurrentBPlus;
+        LeafCopy leaf;
+        int pos = 0;
+        Key low{}, high{};
+        void settle() {
+            while (leaf.node != nullptr && pos < 0) {
+                Node* at = leaf.node;
+                Node* prev = leaf.prev;
+                leaf.node = nullptr;
+                while (prev != nullptr) {
+                    readLeaf(prev, leaf);
+                    if (leaf.next == at) break;
+                    prev = leaf.next;
+                    leaf.node = nullptr;
+                }
+                pos = upperIndex(leaf.keys, leaf.keyCount, high) - 1;
+            }
+            if (leaf.node != nullptr && leaf.keys[pos] < low) leaf.node = nullptr;
+        }
+    };
+    ReverseCursor reverseCursor(const Key& low, const Key& high) const {
+        ReverseCursor c;
+        c.low = low;
+        c.high = high;
+        // right on equal keys, then on to the last leaf that starts at or below high: a split can
+        // have moved the top of the range right, and empty leaves say nothing either way
+        readLeaf(findLeaf(high, true), c.leaf);
+        LeafCopy ahead;
+        for (Node* next = c.leaf.next; next != nullptr; next = ahead.next) {
+            readLeaf(next, ahead);
+            if (ahead.keyCount == 0) continue;
+            if (high < ahead.keys[0]) break;
+            c.leaf = ahead;
+        }
+        c.pos = upperIndex(c.leaf.keys, c.leaf.keyCount, high) - 1;
+        c.settle();
+        return c;
+    }
+
+    // RANGE QUERY - skips the first offset matches and stops after limit, like BasicBPlus
+    std::vector<Value> rangeQuery(const Key& low, const Key& high, size_t limit = SIZE_MAX, size_t offset = 0) const {
+        std::vector<Value> ret;
+        if (high < low) return ret;
+        Cursor c = cursor(low, high);
+        for (; c.valid() && offset > 0; c.next()) {
+            offset--;
+        }
+        for (; c.valid() && ret.size() < limit; c.next()) {
+            ret.push_back(c.value());
+        }
+        return ret;
+    }
+    // same page counted from the top of the range, largest key first
+    std::vector<Value> reverseRangeQuery(const Key& low, const Key& high, size_t limit = SIZE_MAX, size_t offset = 0) const {
+        std::vector<Value> ret;
+        if (high < low) return ret;
+        ReverseCursor c = reverseCursor(low, high);
+        for (; c.valid() && offset > 0; c.next()) {
+            offset--;
+        }
+        for (; c.valid() && ret.size() < limit; c.next()) {
+            ret.push_back(c.value());
+        }
+        return ret;
+    }
+
+    // COUNT - walks the leaves of the range. Keeping per-child counts like BasicBPlus would mean
+    // latching every node on an insert's path, not just the leaf.
+    size_t countRange(const Key& low, const Key& high) const {
+        if (high < low) return 0;
+        size_t n = 0;
+        for (Cursor c = cursor(low, high); c.valid(); c.next()) n++;
+        return n;
+    }
+    size_t size() const { return entries.load(std::memory_order_relaxed); }
+
+    Value search(const Key& key) const { // Value() when the key is absent
+        Cursor c = cursor(key, key);
+        return c.valid() ? c.value() : Value();
+    }
+
+    // safe alongside readers and other writers; copies of a key keep their insertion order
+    void insert(const Key& key, const Value& value) {
+        while (!tryInsert(key, value)) {}
+        entries.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // removes the entry with this key and value (keys can repeat, the value says which one), false
+    // if there is none. Only its leaf is latched; the leaf is left as small as the erase makes it.
+    bool erase(const Key& key, const Value& value) {
+        Node* node = findLeaf(key, false);
+        for (;;) {
+            uint64_t v = stableVersion(node);
+            int n = count(node);
+            int i = 0;
+            while (i < n && node->keys[i].load(std::memory_order_relaxed) < key) i++;
+            int at = -1;
+            for (; i < n && node->keys[i].load(std::memory_order_relaxed) == key; i++) {
+                if (node->data[i].load(std::memory_order_relaxed) == value) {
+                    at = i;
+                    break;
+                }
+            }
+            Node* next = node->next.load(std::memory_order_acquire);
+            if (!validate(node, v)) continue; // changed under us: read this leaf again
+            if (at < 0) {
+                if (i < n || next == nullptr) return false; // reached a larger key, or the end
+                node = next; // copies of key can go on in the next leaf
+                continue;
+            }
+            if (!tryLock(node, v)) continue; // entries only ever move right, so rereading finds it
+            for (int j = at; j < n - 1; j++) {
+                node->keys[j].store(node->keys[j + 1].load(std::memory_order_relaxed), std::memory_order_relaxed);
+                node->data[j].store(node->data[j + 1].load(std::memory_order_relaxed), std::memory_order_relaxed);
+            }
+            node->keyCount.store(n - 1, std::memory_order_relaxed);
+            unlock(node);
+            entries.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    // moves an entry to a new key, false if it was not there. Readers can miss the entry between
+    // the two steps.
+    bool update(const Key& oldKey, const Key& newKey, const Value& value) {
+        if (!erase(oldKey, value)) {
+            return false;
+        }
+        insert(newKey, value);
+        return true;
+    }
+
+    // builds the tree bottom-up from entries already sorted by key (pairs of key, value), replacing
+    // the current contents. fillFactor below 1.0 leaves room in every node for later inserts.
+    template <typename It>
+    void bulkLoad(It first, It last, double fillFactor = 1.0) {
+        clear();
+        size_t n = static_cast<size_t>(std::distance(first, last));
+        if (n == 0) return;
+        const int lo = 2, hi = maxKeys; // copies, min/max take references
+        int fill = std::max(lo, std::min(hi, static_cast<int>(hi * fillFactor + 0.5)));
+
+        std::vector<Node*> level;
+        std::vector<Key> lowKeys; // smallest key under each node of the current level
+        size_t groups = (n + fill - 1) / fill;
+        Node* prev = nullptr;
+        for (size_t g = 0; g < groups; g++) {
+            Node* leaf = g == 0 ? root.load(std::memory_order_relaxed) : newNode(true); // clear() left an empty leaf
+            int keys = static_cast<int>(n / groups + (g < n % groups ? 1 : 0));
+            for (int k = 0; k < keys; k++, ++first) {
+                leaf->keys[k].store(first->first, std::memory_order_relaxed);
+                leaf->data[k].store(first->second, std::memory_order_relaxed);
+            }
+            leaf->keyCount.store(keys, std::memory_order_relaxed);
+            leaf->prev.store(prev, std::memory_order_relaxed);
+            if (prev) prev->next.store(leaf, std::memory_order_relaxed);
+            prev = leaf;
+            level.push_back(leaf);
+            lowKeys.push_back(leaf->keys[0].load(std::memory_order_relaxed));
+        }
+        // internal levels: a node with g children gets the low keys of children 1..g-1 as separators
+        while (level.size() > 1) {
+            size_t c = level.size();
+            size_t parents = (c + fill) / (fill + 1);
+            std::vector<Node*> upper;
+            std::vector<Key> upperLows;
+            size_t child = 0;
+            for (size_t g = 0; g < parents; g++) {
+                size_t kids = c / parents + (g < c % parents ? 1 : 0);
+                Node* node = newNode(false);
+                upperLows.push_back(lowKeys[child]);
+                for (size_t k = 0; k < kids; k++, child++) {
+                    node->children[k].store(level[child], std::memory_order_relaxed);
+                    if (k > 0) node->keys[k - 1].store(lowKeys[child], std::memory_order_relaxed);
+                }
+                node->keyCount.store(static_cast<int>(kids - 1), std::memory_order_relaxed);
+                upper.push_back(node);
+            }
+            level.swap(upper);
+            lowKeys.swap(upperLows);
+        }
+        entries.store(n, std::memory_order_relaxed);
+        root.store(level[0], std::memory_order_release);
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        pool.releaseAll();
+        entries.store(0, std::memory_order_relaxed);
+        root.store(pool.create(true), std::memory_order_release);
+    }
+
+    //read mem for ui: what the node slabs actually take, unused slab space included
+    size_t approxBytes() const {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        return pool.bytesReserved();
+    }
+
+private:
+    std::atomic<Node*> root{nullptr};
+    std::atomic<size_t> entries{0};
+    NodePool<Node> pool;
+    mutable std::mutex poolMutex; // only taken to allocate, i.e. on splits
+
+    Node* newNode(bool leaf) {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        return pool.create(leaf);
+    }
+
+    // --- version latch ---
+    static void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#endif
+    }
+    // waits out a writer that holds the node, then returns the version to validate against
+    static uint64_t stableVersion(const Node* node) {
+        uint64_t v = node->version.load(std::memory_order_acquire);
+        while (v & 1) {
+            cpuRelax();
+            v = node->version.load(std::memory_order_acquire);
+        }
+        return v;
+    }
+    // true when nothing was written to the node since v was taken, so what was read from it holds
+    static bool validate(const Node* node, uint64_t v) {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return node->version.load(std::memory_order_relaxed) == v;
+    }
+    // turns a validated read into a write latch, false if someone got there first
+    static bool tryLock(Node* node, uint64_t v) {
+        if (!node->version.compare_exchange_strong(v, v + 1, std::memory_order_acquire)) return false;
+        std::atomic_thread_fence(std::memory_order_release); // readers must see the odd version before any write
+        return true;
+    }
+    static void unlock(Node* node) { node->version.fetch_add(1, std::memory_order_release); }
+
+    // keyCount as read while a writer may be shifting the node; kept in bounds so a torn read can
+    // only fail validation, never index past the arrays
+    static int count(const Node* node) {
+        return std::min(std::max(node->keyCount.load(std::memory_order_relaxed), 0), maxKeys);
+    }
+    // first index whose key is >= key / > key, on a node being read optimistically or on a copy
+    static int lowerIndex(const Node* node, int n, const Key& key) {
+        int lo = 0;
+        while (lo < n) {
+            int mid = lo + (n - lo) / 2;
+            if (node->keys[mid].load(std::memory_order_relaxed) < key) lo = mid + 1; else n = mid;
+        }
+        return lo;
+    }
+    static int upperIndex(const Node* node, int n, const Key& key) {
+        int lo = 0;
+        while (lo < n) {
+            int mid = lo + (n - lo) / 2;
+            if (key < node->keys[mid].load(std::memory_order_relaxed)) n = mid; else lo = mid + 1;
+        }
+        return lo;
+    }
+    static int lowerIndex(const Key* keys, int n, const Key& key) { return static_cast<int>(std::lower_bound(keys, keys + n, key) - keys); }
+    static int upperIndex(const Key* keys, int n, const Key& key) { return static_cast<int>(std::upper_bound(keys, keys + n, key) - keys); }
+
+    // copies leaf at one version, rereading it until no writer got in between
+    static void readLeaf(Node* leaf, LeafCopy& out) {
+        for (;;) {
+            uint64_t v = stableVersion(leaf);
+            int n = count(leaf);
+            for (int i = 0; i < n; i++) {
+                out.keys[i] = leaf->keys[i].load(std::memory_order_relaxed);
+                out.data[i] = leaf->data[i].load(std::memory_order_relaxed);
+            }
+            out.next = leaf->next.load(std::memory_order_acquire);
+            out.prev = leaf->prev.load(std::memory_order_acquire);
+            if (validate(leaf, v)) {
+                out.node = leaf;
+                out.keyCount = n;
+                return;
+            }
+        }
+    }
+
+    // optimistic walk to the leaf for key, left on equal keys (upper: right); starts over when a
+    // node changed on the way. The leaf can split once we are there, but only to its right, where
+    // every caller walks on to anyway.
+    Node* findLeaf(const Key& key, bool upper) const {
+        for (;;) {
+            Node* node = root.load(std::memory_order_acquire);
+            uint64_t v = stableVersion(node);
+            if (node != root.load(std::memory_order_acquire)) continue; // the root split meanwhile
+            while (node != nullptr && !node->isLeaf) {
+                int n = count(node);
+                Node* child = node->children[upper ? upperIndex(node, n, key) : lowerIndex(node, n, key)].load(std::memory_order_acquire);
+                if (child == nullptr || !validate(node, v)) {
+                    node = nullptr;
+                    break;
+                }
+                uint64_t cv = stableVersion(child);
+                if (!validate(node, v)) { // child split after we picked it, its parent changed too
+                    node = nullptr;
+                    break;
+                }
+                node = child;
+                v = cv;
+            }
+            if (node != nullptr) return node;
+        }
+    }
+
+    // one attempt: false means a conflict (or a split was just done) and the caller starts over
+    bool tryInsert(const Key& key, const Value& value) {
+        Node* node = root.load(std::memory_order_acquire);
+        uint64_t v = stableVersion(node);
+        if (node != root.load(std::memory_order_acquire)) return false;
+        Node* parent = nullptr;
+        uint64_t pv = 0;
+        for (;;) {
+            int n = count(node);
+            if (!validate(node, v)) return false;
+            if (n == maxKeys) { // full: split it now, the parent (already known not full) takes the separator
+                if (parent != nullptr && !tryLock(parent, pv)) return false;
+                if (!tryLock(node, v)) {
+                    if (parent != nullptr) unlock(parent);
+                    return false;
+                }
+                if (parent == nullptr && node != root.load(std::memory_order_acquire)) {
+                    unlock(node);
+                    return false;
+                }
+                split(node, parent);
+                unlock(node);
+                if (parent != nullptr) unlock(parent);
+                return false; // go again from the top, now with room on the path
+            }
+            if (node->isLeaf) {
+                if (!tryLock(node, v)) return false;
+                int i = upperIndex(node, n, key); // after any copies already there
+                for (int j = n; j > i; j--) {
+                    node->keys[j].store(node->keys[j - 1].load(std::memory_order_relaxed), std::memory_order_relaxed);
+                    node->data[j].store(node->data[j - 1].load(std::memory_order_relaxed), std::memory_order_relaxed);
+                }
+                node->keys[i].store(key, std::memory_order_relaxed);
+                node->data[i].store(value, std::memory_order_relaxed);
+                node->keyCount.store(n + 1, std::memory_order_relaxed);
+                unlock(node);
+                return true;
+            }
+            Node* child = node->children[upperIndex(node, n, key)].load(std::memory_order_acquire);
+            if (child == nullptr || !validate(node, v)) return false;
+            uint64_t cv = stableVersion(child);
+            if (!validate(node, v)) return false;
+            parent = node;
+            pv = v;
+            node = child;
+            v = cv;
+        }
+    }
+
+    // both latched (parent null when node is the root); moves the upper half of node into a new
+    // right sibling and hangs it off the parent, or off a new root
+    void split(Node* node, Node* parent) {
+        const auto relaxed = std::memory_order_relaxed;
+        Node* right = newNode(node->isLeaf);
+        int n = node->keyCount.load(relaxed);
+        int half = n / 2;
+        Key sep;
+        if (node->isLeaf) {
+            int moved = n - half;
+            for (int i = 0; i < moved; i++) {
+                right->keys[i].store(node->keys[half + i].load(relaxed), relaxed);
+                right->data[i].store(node->data[half + i].load(relaxed), relaxed);
+            }
+            right->keyCount.store(moved, relaxed);
+            right->next.store(node->next.load(relaxed), relaxed);
+            right->prev.store(node, relaxed);
+            sep = right->keys[0].load(relaxed);
+        } else { // keys[half] moves up
+            int moved = n - half - 1;
+            for (int i = 0; i < moved; i++) {
+                right->keys[i].store(node->keys[half + 1 + i].load(relaxed), relaxed);
+            }
+            for (int i = 0; i <= moved; i++) {
+                right->children[i].store(node->children[half + 1 + i].load(relaxed), relaxed);
+            }
+            right->keyCount.store(moved, relaxed);
+            sep = node->keys[half].load(relaxed);
+        }
+        // right is still private; the release stores below (and the unlocks) publish it
+        if (node->isLeaf) {
+            Node* after = node->next.load(relaxed);
+            node->next.store(right, std::memory_order_release);
+            if (after != nullptr) after->prev.store(right, std::memory_order_release); // only this leaf's split writes it
+        }
+        node->keyCount.store(half, relaxed);
+
+        if (parent == nullptr) {
+            Node* newRoot = newNode(false);
+            newRoot->keys[0].store(sep, relaxed);
+            newRoot->children[0].store(node, relaxed);
+            newRoot->children[1].store(right, relaxed);
+            newRoot->keyCount.store(1, relaxed);
+            root.store(newRoot, std::memory_order_release);
+            return;
+        }
+        int pn = parent->keyCount.load(relaxed);
+        int at = 0;
+        while (parent->children[at].load(relaxed) != node) at++;
+        for (int i = pn; i > at; i--) {
+            parent->keys[i].store(parent->keys[i - 1].load(relaxed), relaxed);
+            parent->children[i + 1].store(parent->children[i].load(relaxed), relaxed);
+        }
+        parent->keys[at].store(sep, relaxed);
+        parent->children[at + 1].store(right, std::memory_order_release);
+        parent->keyCount.store(pn + 1, relaxed);
+    }
+};
+
+#endif //CONCURRENTBPLUS_H
@@ -0,0 +1,144 @@
+#ifndef KEYSEARCH_H
+#define KEYSEARCH_H
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+// In-node key search shared by both trees. Keys in a node are sorted, so "how many keys are below
+// the probe" is just a count of matching lanes: a block of keys is compared against the broadcast
+// probe at once and the movemask popcount gives the branch index. The SIMD paths are only built on
+// x86-64 with gcc/clang and picked at runtime from what the cpu supports; everything else (and any
+// key type that is not a 32/64-bit signed integer) goes through the plain loop.
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define KEYSEARCH_X86 1
+#include <immintrin.h>
+#endif
+
+namespace keysearch {
+
+enum Level { SCALAR = 0, SSE42 = 1, AVX2 = 2 };
+
+inline Level detectLevel() {
+#ifdef KEYSEARCH_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return AVX2;
+    if (__builtin_cpu_supports("sse4.2")) return SSE42;
+#endif
+    return SCALAR;
+}
+inline const Level level = detectLevel(); // resolved once at startup
+
+template <typename Key>
+inline constexpr bool kSimdKey = std::is_same_v<Key, int32_t> || std::is_same_v<Key, int64_t>;
+
+template <typename Key>
+inline int countLessScalar(const Key* keys, int n, const Key& key, int i = 0) {
+    while (i < n && keys[i] < key) i++;
+    return i;
+}
+template <typename Key>
+inline int countLessEqualScalar(const Key* keys, int n, const Key& key, int i = 0) {
+    while (i < n && keys[i] <= key) i++;
+    return i;
+}
+
+#ifdef KEYSEARCH_X86
+// blocks are compared until the first one that is not entirely below the probe; no load goes past
+// n (AVX2 masks the tail, SSE leaves it to the scalar loop). orEqual compares probe+1 > key, i.e.
+// key <= probe (the caller rules out probe == max)
+template <bool orEqual>
+__attribute__((target("avx2"))) inline int count32Avx2(const int32_t* keys, int n, int32_t probe) {
+    const __m256i p = _mm256_set1_epi32(orEqual ? probe + 1 : probe);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i k = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + i));
+        int mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(p, k)));
+        if (mask != 0xFF) return i + __builtin_popcount(mask);
+    }
+    if (i < n) { // masked load for the tail, lanes past n are never touched
+        __m256i live = _mm256_cmpgt_epi32(_mm256_set1_epi32(n - i), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+        __m256i k = _mm256_maskload_epi32(keys + i, live);
+        __m256i below = _mm256_and_si256(_mm256_cmpgt_epi32(p, k), live);
+        i += __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(below)));
+    }
+    return i;
+}
+template <bool orEqual>
+__attribute__((target("avx2"))) inline int count64Avx2(const int64_t* keys, int n, int64_t probe) {
+    const __m256i p = _mm256_set1_epi64x(orEqual ? probe + 1 : probe);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i k = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + i));
+        int mask = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(p, k)));
+        if (mask != 0xF) return i + __builtin_popcount(mask);
+    }
+    if (i < n) {
+        __m256i live = _mm256_cmpgt_epi64(_mm256_set1_epi64x(n - i), _mm256_setr_epi64x(0, 1, 2, 3));
+        __m256i k = _mm256_maskload_epi64(reinterpret_cast<const long long*>(keys + i), live);
+        __m256i below = _mm256_and_si256(_mm256_cmpgt_epi64(p, k), live);
+        i += __builtin_popcount(_mm256_movemask_pd(_mm256_castsi256_pd(below)));
+    }
+    return i;
+}
+template <bool orEqual>
+__attribute__((target("sse4.2"))) inline int count32Sse(const int32_t* keys, int n, int32_t probe) {
+    const __m128i p = _mm_set1_epi32(orEqual ? probe + 1 : probe);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i k = _mm_loadu_si128(reinterpret_cast<const __m128i*>(keys + i));
+        int mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(p, k)));
+        if (mask != 0xF) return i + __builtin_popcount(mask);
+    }
+    return i;
+}
+template <bool orEqual>
+__attribute__((target("sse4.2"))) inline int count64Sse(const int64_t* keys, int n, int64_t probe) {
+    const __m128i p = _mm_set1_epi64x(orEqual ? probe + 1 : probe);
+    int i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128i k = _mm_loadu_si128(reinterpret_cast<const __m128i*>(keys + i));
+        int mask = _mm_movemask_pd(_mm_castsi128_pd(_mm_cmpgt_epi64(p, k)));
+        if (mask != 0x3) return i + __builtin_popcount(mask);
+    }
+    return i;
+}
+
+template <bool orEqual, typename Key>
+inline int countSimd(const Key* keys, int n, const Key& key) {
+    if (level == AVX2) {
+        if constexpr (sizeof(Key) == 4) return count32Avx2<orEqual>(keys, n, key);
+        else return count64Avx2<orEqual>(keys, n, key);
+    }
+    int i;
+    if constexpr (sizeof(Key) == 4) i = count32Sse<orEqual>(keys, n, key);
+    else i = count64Sse<orEqual>(keys, n, key);
+    // keys are sorted, so after an early stop the scalar loop ends at once; otherwise it does the tail
+    return orEqual ? countLessEqualScalar(keys, n, key, i) : countLessScalar(keys, n, key, i);
+}
+#endif
+
+// number of keys < key, i.e. the first index whose key is >= key
+template <typename Key>
+inline int lowerIndex(const Key* keys, int n, const Key& key) {
+#ifdef KEYSEARCH_X86
+    if constexpr (kSimdKey<Key>) {
+        if (level != SCALAR) return countSimd<false>(keys, n, key);
+    }
+#endif
+    return countLessScalar(keys, n, key);
+}
+
+// number of keys <= key, i.e. the first index whose key is > key
+template <typename Key>
+inline int upperIndex(const Key* keys, int n, const Key& key) {
+#ifdef KEYSEARCH_X86
+    if constexpr (kSimdKey<Key>) {
+        if (level != SCALAR && key != std::numeric_limits<Key>::max()) return countSimd<true>(keys, n, key);
+    }
+#endif
+    return countLessEqualScalar(keys, n, key);
+}
+
+} // namespace keysearch
+
+#endif //KEYSEARCH_H
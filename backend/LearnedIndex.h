@@ -0,0 +1,253 @@
+#ifndef LEARNEDINDEX_H
+#define LEARNEDINDEX_H
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <ostream>
+#include <type_traits>
+#include <vector>
+#include "KeySearch.h"
+#include "Serialize.h"
+
+// Learned index for an integer key. Rather than a tree, a piecewise linear model maps a key to its
+// position in the sorted array of distinct keys, off by at most Epsilon. The segments are fitted
+// greedily with a shrinking cone (as PGM / FITing-tree build theirs). A lookup binary searches the
+// segment start keys, evaluates one line, and finishes with a search of 2*Epsilon+3 keys around the
+// prediction. Record ids are grouped by key as in PostingIndex, so results and their order match
+// the posting trees. Built by bulk load; single records can then be moved between keys.
+template <typename Key, typename Record, int Epsilon = 32>
+class LearnedIndex {
+    static_assert(std::is_integral_v<Key>, "the model does arithmetic on keys");
+public:
+    using key_type = Key;
+
+    explicit LearnedIndex(Record* base) : base(base) {}
+    LearnedIndex(const LearnedIndex&) = delete;
+    LearnedIndex& operator=(const LearnedIndex&) = delete;
+
+    // entries are (key, record pointer) pairs sorted by key, as for the trees; fillFactor is
+    // accepted for the same signature but there is nothing to leave room in
+    template <typename It>
+    void bulkLoad(It first, It last, double = 1.0) {
+        clear();
+        ids.reserve(static_cast<size_t>(std::distance(first, last)));
+        for (It it = first; it != last; ++it) {
+            if (keys.empty() || keys.back() != it->first) {
+                keys.push_back(it->first);
+                starts.push_back(static_cast<uint32_t>(ids.size()));
+            }
+            ids.push_back(recordToId<Record>(it->second, base));
+        }
+        starts.push_back(static_cast<uint32_t>(ids.size()));
+        train();
+    }
+
+    // the records whose key is in [low, high], in key order, after skipping offset and at most limit
+    std::vector<Record*> rangeQuery(const Key& low, const Key& high, size_t limit = SIZE_MAX, size_t offset = 0) const {
+        std::vector<Record*> out;
+        auto span = slice(low, high);
+        size_t n = span.second - span.first;
+        if (offset >= n) return out;
+        n = std::min(n - offset, limit);
+        out.reserve(n);
+        for (size_t i = span.first + offset; i != span.first + offset + n; ++i) out.push_back(base + ids[i]);
+        return out;
+    }
+    // the same page counted from the top of the range, largest key and last loaded record first
+    std::vector<Record*> reverseRangeQuery(const Key& low, const Key& high, size_t limit = SIZE_MAX, size_t offset = 0) const {
+        std::vector<Record*> out;
+        auto span = slice(low, high);
+        size_t n = span.second - span.first;
+        if (offset >= n) return out;
+        n = std::min(n - offset, limit);
+        out.reserve(n);
+        for (size_t i = span.second - offset; i != span.second - offset - n; --i) out.push_back(base + ids[i - 1]);
+        return out;
+    }
+    size_t countRange(const Key& low, const Key& high) const {
+        auto span = slice(low, high);
+        return span.second - span.first;
+    }
+
+    // Corrections, as in PostingIndex: the id goes in (or out) at its place in the key's group and
+    // later groups move by one. Only a key that appears or disappears changes what the model
+    // fits, so only then is it refitted (one pass over the keys).
+
+    // files record under key, in id order among the key's records as a bulk load leaves them
+    void insert(const Key& key, Record* record) {
+        uint32_t id = recordToId<Record>(record, base);
+        if (starts.empty()) starts.push_back(0); // never loaded
+        size_t i = lowerBound(key);
+        bool known = i < keys.size() && keys[i] == key;
+        if (!known) {
+            keys.insert(keys.begin() + i, key);
+            starts.insert(starts.begin() + i, starts[i]); // an empty group where the next one starts
+        }
+        auto at = std::upper_bound(ids.begin() + starts[i], ids.begin() + starts[i + 1], id);
+        ids.insert(at, id);
+        for (size_t j = i + 1; j < starts.size(); j++) starts[j]++;
+        if (!known) train();
+    }
+    // takes record out of key's group, false when it is not filed under key
+    bool erase(const Key& key, const Record* record) {
+        uint32_t id = recordToId<Record>(record, base);
+        size_t i = lowerBound(key);
+        if (i >= keys.size() || keys[i] != key) return false;
+        auto end = ids.begin() + starts[i + 1];
+        auto at = std::find(ids.begin() + starts[i], end, id);
+        if (at == end) return false;
+        ids.erase(at);
+        for (size_t j = i + 1; j < starts.size(); j++) starts[j]--;
+        if (starts[i] == starts[i + 1]) { // its last record: the key goes too
+            keys.erase(keys.begin() + i);
+            starts.erase(starts.begin() + i);
+            train();
+        }
+        return true;
+    }
+    // moves a record to a new key (a corrected timestamp), false if it was not under oldKey
+    bool update(const Key& oldKey, const Key& newKey, Record* record) {
+        if (!erase(oldKey, record)) return false;
+        insert(newKey, record);
+        return true;
+    }
+
+    Record* search(const Key& key) const { // first record with the key, nullptr when absent
+        size_t i = lowerBound(key);
+        return i < keys.size() && keys[i] == key ? base + ids[starts[i]] : nullptr;
+    }
+
+    void clear() {
+        std::vector<Key>().swap(keys);
+        std::vector<uint32_t>().swap(starts);
+        std::vector<uint32_t>().swap(ids);
+        std::vector<Segment>().swap(segments);
+        std::vector<Key>().swap(segmentKeys);
+    }
+
+    // on disk: the distinct keys, their group starts and the ids; the model is refitted on load,
+    // which is one pass over the keys
+    template <typename R>
+    void serialize(std::ostream& out, const R*) const {
+        writePod(out, shape());
+        writePod<uint64_t>(out, keys.size());
+        writePod<uint64_t>(out, ids.size());
+        writePods(out, keys.data(), keys.size());
+        writePods(out, starts.data(), starts.size());
+        writePods(out, ids.data(), ids.size());
+    }
+    bool deserialize(ByteReader& in, Record* storeBase, size_t recordCount) {
+        clear();
+        base = storeBase;
+        TreeShape stored{};
+        uint64_t d = 0, n = 0;
+        if (!in.read(stored) || !(stored == shape()) || !in.read(d) || !in.read(n) || n > recordCount || d > n) return false;
+        keys.resize(static_cast<size_t>(d));
+        starts.resize(static_cast<size_t>(d) + 1);
+        ids.resize(static_cast<size_t>(n));
+        if (!in.readN(keys.data(), keys.size()) || !in.readN(starts.data(), starts.size()) || !in.readN(ids.data(), ids.size())) {
+            clear();
+            return false;
+        }
+        bool ok = starts.front() == 0 && starts.back() == n;
+        for (size_t i = 0; ok && i < keys.size(); i++) {
+            ok = starts[i] < starts[i + 1] && (i == 0 || keys[i - 1] < keys[i]);
+        }
+        for (size_t i = 0; ok && i < ids.size(); i++) ok = ids[i] < recordCount;
+        if (!ok) {
+            clear();
+            return false;
+        }
+        train();
+        return true;
+    }
+
+    // read mem for ui: keys, group starts, ids and the model
+    size_t approxBytes() const {
+        return keys.capacity() * sizeof(Key) + starts.capacity() * sizeof(uint32_t) + ids.capacity() * sizeof(uint32_t) + modelBytes();
+    }
+    // just the part that replaces the tree's inner nodes
+    size_t modelBytes() const { return segments.capacity() * sizeof(Segment) + segmentKeys.capacity() * sizeof(Key); }
+    size_t segmentCount() const { return segments.size(); }
+
+private:
+    struct Segment {
+        Key key;      // first key it covers
+        double slope; // positions per key unit
+        uint32_t pos; // position of key
+    };
+
+    static TreeShape shape() { return TreeShape{sizeof(Key), sizeof(uint32_t), static_cast<uint32_t>(Epsilon)}; }
+    static double distance(const Key& to, const Key& from) { return static_cast<double>(to) - static_cast<double>(from); }
+
+    // one pass: a segment grows while some slope through its first point keeps every key within
+    // Epsilon positions; the cone of such slopes only narrows, and the segment ends when it is empty
+    void train() {
+        segments.clear();
+        segmentKeys.clear();
+        size_t d = keys.size();
+        const double eps = Epsilon;
+        for (size_t i = 0; i < d;) {
+            double lo = 0.0, hi = std::numeric_limits<double>::infinity();
+            size_t j = i + 1;
+            for (; j < d; j++) {
+                double dx = distance(keys[j], keys[i]);
+                double dy = static_cast<double>(j - i);
+                double l = std::max(lo, (dy - eps) / dx), h = std::min(hi, (dy + eps) / dx);
+                if (l > h) break;
+                lo = l;
+                hi = h;
+            }
+            double slope = std::isinf(hi) ? lo : (lo + hi) / 2;
+            segments.push_back(Segment{keys[i], slope, static_cast<uint32_t>(i)});
+            segmentKeys.push_back(keys[i]);
+            i = j;
+        }
+        segments.shrink_to_fit();
+        segmentKeys.shrink_to_fit();
+    }
+
+    // first distinct key >= key
+    size_t lowerBound(const Key& key) const {
+        size_t d = keys.size();
+        if (d == 0 || !(keys[0] < key)) return 0;
+        if (keys.back() < key) return d;
+        size_t s = static_cast<size_t>(std::upper_bound(segmentKeys.begin(), segmentKeys.end(), key) - segmentKeys.begin()) - 1;
+        const Segment& seg = segments[s];
+        size_t begin = seg.pos;
+        size_t end = s + 1 < segments.size() ? segments[s + 1].pos : d; // the answer is in [begin, end]
+        double p = static_cast<double>(seg.pos) + seg.slope * distance(key, seg.key);
+        double limit = static_cast<double>(end);
+        auto clampTo = [&](double v) { return static_cast<size_t>(std::min(std::max(v, static_cast<double>(begin)), limit)); };
+        size_t from = clampTo(std::floor(p) - Epsilon - 1);
+        size_t to = clampTo(std::floor(p) + Epsilon + 2);
+        size_t i = from + static_cast<size_t>(keysearch::lowerIndex(keys.data() + from, static_cast<int>(to - from), key));
+        // the bound holds up to float rounding; if the window still missed, finish on the whole segment
+        if ((i == to && to < end && keys[to] < key) || (i == from && from > begin && !(keys[from - 1] < key))) {
+            i = static_cast<size_t>(std::lower_bound(keys.begin() + begin, keys.begin() + end, key) - keys.begin());
+        }
+        return i;
+    }
+    size_t upperBound(const Key& key) const { // first distinct key > key
+        return key == std::numeric_limits<Key>::max() ? keys.size() : lowerBound(key + 1);
+    }
+
+    // [from, to) of the id array covering keys in [low, high]
+    std::pair<size_t, size_t> slice(const Key& low, const Key& high) const {
+        if (high < low || keys.empty()) return {0, 0};
+        size_t a = lowerBound(low), b = upperBound(high);
+        if (a >= b) return {0, 0};
+        return {starts[a], starts[b]};
+    }
+
+    std::vector<Key> keys;        // distinct keys, ascending
+    std::vector<uint32_t> starts; // ids of keys[i] are ids[starts[i] .. starts[i+1])
+    std::vector<uint32_t> ids;
+    std::vector<Segment> segments;
+    std::vector<Key> segmentKeys; // segments[i].key, packed for the binary search
+    Record* base;
+};
+
+#endif //LEARNEDINDEX_H
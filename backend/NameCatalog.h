@@ -0,0 +1,135 @@
+#ifndef NAMECATALOG_H
+#define NAMECATALOG_H
+#include <cctype>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Case-insensitive string dictionary handing out dense ids (0, 1, 2, ... in first-seen order).
+// Lookups go through an open-addressing table of ids (linear probing, power-of-two size, at most
+// half full) keyed by a 64-bit FNV-1a of the upper-cased string, and a hit is always confirmed
+// against the stored string, so two names can never share an id.
+class StringCatalog {
+public:
+    static constexpr uint32_t kNone = 0xFFFFFFFFu;
+
+    uint32_t intern(std::string_view s) {
+        uint64_t h = hashFolded(s);
+        size_t slot = probe(s, h);
+        if (slots[slot] != kNone) return slots[slot];
+        uint32_t id = static_cast<uint32_t>(strings.size());
+        std::string folded(s);
+        for (auto& c : folded) c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+        strings.push_back(std::move(folded));
+        hashes.push_back(h);
+        slots[slot] = id;
+        if (strings.size() * 2 > slots.size()) grow();
+        return id;
+    }
+
+    // interns a list of distinct strings in order, returning each one's id (kNone for an empty string)
+    std::vector<uint32_t> internAll(const std::vector<std::string_view>& list) {
+        std::vector<uint32_t> out;
+        out.reserve(list.size());
+        for (std::string_view s : list) out.push_back(s.empty() ? kNone : intern(s));
+        return out;
+    }
+
+    uint32_t find(std::string_view s) const { // kNone when the string was never interned
+        if (strings.empty()) return kNone;
+        return slots[probe(s, hashFolded(s))];
+    }
+
+    const std::string& value(uint32_t id) const { return strings[id]; } // upper-cased
+    const std::vector<std::string>& values() const { return strings; }
+    size_t size() const { return strings.size(); }
+
+    size_t approxBytes() const {
+        size_t bytes = slots.capacity() * sizeof(uint32_t) + hashes.capacity() * sizeof(uint64_t);
+        for (const auto& s : strings) bytes += sizeof(std::string) + s.capacity();
+        return bytes;
+    }
+
+private:
+    std::vector<std::string> strings; // id -> upper-cased string
+    std::vector<uint64_t> hashes;     // id -> hash, so growing never rehashes strings
+    std::vector<uint32_t> slots = std::vector<uint32_t>(16, kNone);
+
+    static uint64_t hashFolded(std::string_view s) {
+        uint64_t h = 14695981039346656037ull;
+        for (unsigned char c : s) {
+            h ^= static_cast<unsigned char>(std::toupper(c));
+            h *= 1099511628211ull;
+        }
+        return h;
+    }
+    static bool equalFolded(std::string_view query, const std::string& stored) {
+        if (query.size() != stored.size()) return false;
+        for (size_t i = 0; i < query.size(); i++) {
+            if (std::toupper(static_cast<unsigned char>(query[i])) != static_cast<unsigned char>(stored[i])) return false;
+        }
+        return true;
+    }
+    // slot holding s, or the empty slot where it would go
+    size_t probe(std::string_view s, uint64_t h) const {
+        size_t mask = slots.size() - 1;
+        for (size_t i = static_cast<size_t>(h) & mask;; i = (i + 1) & mask) {
+            uint32_t id = slots[i];
+            if (id == kNone || (hashes[id] == h && equalFolded(s, strings[id]))) return i;
+        }
+    }
+    void grow() {
+        std::vector<uint32_t> bigger(slots.size() * 2, kNone);
+        size_t mask = bigger.size() - 1;
+        for (uint32_t id = 0; id < strings.size(); id++) {
+            size_t i = static_cast<size_t>(hashes[id]) & mask;
+            while (bigger[i] != kNone) i = (i + 1) & mask;
+            bigger[i] = id;
+        }
+        slots.swap(bigger);
+    }
+};
+
+// Names and crypto symbols seen at ingest. Name ids are what the name-keyed indexes store; a symbol
+// remembers the name it first appeared with so a ticker query can be given either one.
+struct AssetCatalog {
+    StringCatalog names;
+    StringCatalog symbols;
+    std::vector<uint32_t> symbolName; // symbol id -> name id
+
+    // ids for one record's name and symbol (kNone for an empty symbol)
+    std::pair<uint32_t, uint32_t> add(std::string_view name, std::string_view symbol) {
+        uint32_t nameId = names.intern(name);
+        uint32_t symbolId = StringCatalog::kNone;
+        if (!symbol.empty()) {
+            symbolId = symbols.intern(symbol);
+            if (symbolId == symbolName.size()) symbolName.push_back(nameId);
+        }
+        return {nameId, symbolId};
+    }
+
+    // Seeding without add(): intern the distinct names and symbols in first-seen order (as the snapshot
+    // lists them), which hands out the ids add() would, then link each row's symbol to its name here.
+    // A symbol keeps the name of the first row that has it, as with add().
+    void linkSymbol(uint32_t symbolId, uint32_t nameId) {
+        if (symbolId == StringCatalog::kNone) return;
+        if (symbolId >= symbolName.size()) symbolName.resize(symbols.size(), StringCatalog::kNone);
+        if (symbolName[symbolId] == StringCatalog::kNone) symbolName[symbolId] = nameId;
+    }
+
+    // exact name first, then a symbol; kNone when it is neither
+    uint32_t resolve(std::string_view query) const {
+        uint32_t id = names.find(query);
+        if (id != StringCatalog::kNone) return id;
+        uint32_t sym = symbols.find(query);
+        return sym != StringCatalog::kNone ? symbolName[sym] : StringCatalog::kNone;
+    }
+
+    size_t approxBytes() const {
+        return names.approxBytes() + symbols.approxBytes() + symbolName.capacity() * sizeof(uint32_t);
+    }
+};
+
+#endif //NAMECATALOG_H
@@ -0,0 +1,89 @@
+#ifndef NODEPOOL_H
+#define NODEPOOL_H
+#include <algorithm>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Slab allocator for tree nodes. Nodes are carved out of large aligned slabs in allocation order,
+// so a bulk-loaded tree ends up laid out contiguously, and the whole tree is freed in one go.
+// Single nodes can be handed back (e.g. after a merge) and are reused before the slab grows.
+template <typename T>
+class NodePool {
+    static_assert(std::is_trivially_destructible_v<T>, "pooled nodes are released without running destructors");
+
+    struct FreeNode { FreeNode* next; };
+    static_assert(sizeof(T) >= sizeof(FreeNode), "node too small to hold a free-list link");
+
+    static constexpr size_t kSlabBytes = 256 * 1024;
+    static constexpr size_t kMinSlabNodes = 16;
+
+    std::vector<std::pair<T*, size_t>> slabs; // start, capacity in nodes
+    size_t usedInLast = 0;
+    FreeNode* freeList = nullptr;
+    size_t live = 0;
+
+    void addSlab(size_t nodes) {
+        T* mem = static_cast<T*>(::operator new(nodes * sizeof(T), std::align_val_t(alignof(T))));
+        slabs.emplace_back(mem, nodes);
+        usedInLast = 0;
+    }
+
+public:
+    NodePool() = default;
+    NodePool(const NodePool&) = delete;
+    NodePool& operator=(const NodePool&) = delete;
+    ~NodePool() { releaseAll(); }
+
+    // makes room for n more nodes in one slab (bulk loads know their node count up front)
+    void reserve(size_t n) {
+        size_t left = slabs.empty() ? 0 : slabs.back().second - usedInLast;
+        if (n > left) addSlab(n);
+    }
+
+    template <typename... Args>
+    T* create(Args&&... args) {
+        void* slot;
+        if (freeList != nullptr) {
+            slot = freeList;
+            freeList = freeList->next;
+        } else {
+            if (slabs.empty() || usedInLast == slabs.back().second) {
+                addSlab(std::max(kMinSlabNodes, kSlabBytes / sizeof(T)));
+            }
+            slot = slabs.back().first + usedInLast++;
+        }
+        live++;
+        return new (slot) T(std::forward<Args>(args)...);
+    }
+
+    void destroy(T* node) {
+        if (node == nullptr) return;
+        FreeNode* f = reinterpret_cast<FreeNode*>(node);
+        f->next = freeList;
+        freeList = f;
+        live--;
+    }
+
+    // frees every slab at once; all nodes handed out so far become invalid
+    void releaseAll() {
+        for (auto& slab : slabs) {
+            ::operator delete(slab.first, std::align_val_t(alignof(T)));
+        }
+        slabs.clear();
+        usedInLast = 0;
+        freeList = nullptr;
+        live = 0;
+    }
+
+    size_t liveNodes() const { return live; }
+    size_t bytesReserved() const { // what the slabs really occupy, including unused tail space
+        size_t nodes = 0;
+        for (const auto& slab : slabs) nodes += slab.second;
+        return nodes * sizeof(T);
+    }
+};
+
+#endif //NODEPOOL_H
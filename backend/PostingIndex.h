@@ -0,0 +1,206 @@
+#ifndef POSTINGINDEX_H
+#define POSTINGINDEX_H
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <ostream>
+#include <utility>
+#include <vector>
+#include "Serialize.h"
+
+// where one key's records sit in a posting list; count 0 (the default) means "no such key"
+struct PostingRange {
+    uint32_t first = 0;
+    uint32_t count = 0;
+};
+
+// Index for keys shared by many records (names, timestamps). The tree holds each distinct key once
+// and maps it to a PostingRange; the record ids themselves live in one array grouped by key (load
+// order within a key). Because the groups are laid out in key order, any key range is also one
+// contiguous slice of that array, so a range query is a descent per end plus a sequential read.
+// Tree is a BasicBTree, BasicBPlus or AdaptiveRadixTree with PostingRange values. Built by bulk
+// load; single records can then be moved between keys (see insert/erase).
+template <typename Tree, typename Record>
+class PostingIndex {
+public:
+    using Key = typename Tree::key_type;
+
+    explicit PostingIndex(Record* base) : base(base) {}
+    PostingIndex(const PostingIndex&) = delete;
+    PostingIndex& operator=(const PostingIndex&) = delete;
+
+    // entries are (key, record pointer) pairs sorted by key, as for the plain trees
+    template <typename It>
+    void bulkLoad(It first, It last, double fillFactor = 1.0) {
+        clear();
+        std::vector<std::pair<Key, PostingRange>> keys;
+        ids.reserve(static_cast<size_t>(std::distance(first, last)));
+        for (It it = first; it != last; ++it) {
+            if (keys.empty() || !(keys.back().first == it->first)) {
+                keys.emplace_back(it->first, PostingRange{static_cast<uint32_t>(ids.size()), 0});
+            }
+            keys.back().second.count++;
+            ids.push_back(recordToId<Record>(it->second, base));
+        }
+        tree.bulkLoad(keys.begin(), keys.end(), fillFactor);
+    }
+
+    // the records whose key is in [low, high], in key order, after skipping offset and at most limit
+    std::vector<Record*> rangeQuery(const Key& low, const Key& high, size_t limit = SIZE_MAX, size_t offset = 0) {
+        std::vector<Record*> out;
+        auto slice = postings(low, high, pageEnd(limit, offset));
+        size_t n = static_cast<size_t>(slice.second - slice.first);
+        if (offset >= n) return out;
+        n = std::min(n - offset, limit);
+        out.reserve(n);
+        for (const uint32_t* p = slice.first + offset; p != slice.first + offset + n; ++p) out.push_back(base + *p);
+        return out;
+    }
+    // the same page counted from the top of the range: largest key first, and within a key the last
+    // loaded record first. Only the groups at the top end are visited.
+    std::vector<Record*> reverseRangeQuery(const Key& low, const Key& high, size_t limit = SIZE_MAX, size_t offset = 0) {
+        std::vector<Record*> out;
+        if (high < low) return out;
+        auto span = groupSpan(tree.reverseCursor(low, high), pageEnd(limit, offset));
+        size_t n = span.second - span.first;
+        if (offset >= n) return out;
+        n = std::min(n - offset, limit);
+        out.reserve(n);
+        for (size_t i = span.second - offset; i != span.second - offset - n; --i) out.push_back(base + ids[i - 1]);
+        return out;
+    }
+
+    // records with a key in [low, high]: the groups in range sit side by side in the posting array,
+    // so this is the end of the last one minus the start of the first, one descent from each side
+    size_t countRange(const Key& low, const Key& high) {
+        if (high < low) return 0;
+        auto first = tree.cursor(low, high);
+        if (!first.valid()) return 0;
+        auto last = tree.reverseCursor(low, high);
+        size_t from = first.value().first;
+        size_t to = std::min(ids.size(), static_cast<size_t>(last.value().first) + last.value().count);
+        return from < to ? to - from : 0;
+    }
+
+    // the ids of [low, high] as a [begin, end) slice of the posting array, no copying. With need set,
+    // the walk over key groups stops once the slice holds that many ids, so it may end short of high.
+    std::pair<const uint32_t*, const uint32_t*> postings(const Key& low, const Key& high, size_t need = SIZE_MAX) {
+        if (high < low) return {ids.data(), ids.data()};
+        auto span = groupSpan(tree.cursor(low, high), need);
+        return {ids.data() + span.first, ids.data() + span.second};
+    }
+
+    // Corrections keep the posting array grouped by key: the id goes in (or out) at its place in the
+    // key's group, everything after it moves by one, and so does the start of every later group. So
+    // the queries above are unaffected, and a correction costs a pass over the array and the keys
+    // after it. A key whose last record leaves keeps an empty group (count 0, which nothing finds)
+    // until the next bulk load.
+
+    // files record under key, in id order among the key's records as a bulk load leaves them
+    void insert(const Key& key, Record* record) {
+        uint32_t id = recordToId<Record>(record, base);
+        auto c = tree.cursor(key, std::numeric_limits<Key>::max());
+        bool known = c.valid() && c.key() == key;
+        size_t at = ids.size();
+        if (known) {
+            auto group = groupOf(c.value());
+            at = static_cast<size_t>(std::upper_bound(group.first, group.second, id) - ids.begin());
+        } else if (c.valid()) {
+            at = std::min<size_t>(c.value().first, ids.size());
+        }
+        ids.insert(ids.begin() + at, id);
+        tree.updateValues(key, std::numeric_limits<Key>::max(), [&](const Key& k, PostingRange& r) {
+            if (k == key) r.count++;
+            else r.first++;
+        });
+        if (!known) tree.insert(key, PostingRange{static_cast<uint32_t>(at), 1});
+    }
+    // takes record out of key's group, false when it is not filed under key
+    bool erase(const Key& key, const Record* record) {
+        uint32_t id = recordToId<Record>(record, base);
+        auto c = tree.cursor(key, key);
+        if (!c.valid()) return false;
+        auto group = groupOf(c.value());
+        auto at = std::find(group.first, group.second, id);
+        if (at == group.second) return false;
+        ids.erase(at);
+        tree.updateValues(key, std::numeric_limits<Key>::max(), [&](const Key& k, PostingRange& r) {
+            if (k == key) r.count--;
+            else r.first--;
+        });
+        return true;
+    }
+    // moves a record to a new key (a corrected timestamp or price), false if it was not under oldKey
+    bool update(const Key& oldKey, const Key& newKey, Record* record) {
+        if (!erase(oldKey, record)) return false;
+        insert(newKey, record);
+        return true;
+    }
+
+    Record* search(const Key& key) { // first record with the key, nullptr when absent
+        PostingRange r = tree.search(key);
+        return r.count > 0 && r.first < ids.size() ? base + ids[r.first] : nullptr;
+    }
+
+    void clear() {
+        tree.clear();
+        std::vector<uint32_t>().swap(ids);
+    }
+
+    // on disk: id count, ids, then the tree
+    template <typename R>
+    void serialize(std::ostream& out, const R* storeBase) const {
+        writePod<uint64_t>(out, ids.size());
+        writePods(out, ids.data(), ids.size());
+        tree.serialize(out, storeBase);
+    }
+    bool deserialize(ByteReader& in, Record* storeBase, size_t recordCount) {
+        clear();
+        base = storeBase;
+        uint64_t n = 0;
+        if (!in.read(n) || n > recordCount) return false;
+        ids.resize(static_cast<size_t>(n));
+        if (!in.readN(ids.data(), ids.size())) { clear(); return false; }
+        for (uint32_t id : ids) {
+            if (id >= recordCount) { clear(); return false; }
+        }
+        if (!tree.deserialize(in, storeBase, recordCount)) { clear(); return false; }
+        return true;
+    }
+
+    // read mem for ui: the tree's node slabs plus the posting array
+    size_t approxBytes() const { return tree.approxBytes() + ids.capacity() * sizeof(uint32_t); }
+
+private:
+    static size_t pageEnd(size_t limit, size_t offset) { return limit > SIZE_MAX - offset ? SIZE_MAX : offset + limit; }
+
+    // a group's ids, clamped to the array so a damaged file can't send us past it
+    std::pair<std::vector<uint32_t>::iterator, std::vector<uint32_t>::iterator> groupOf(const PostingRange& r) {
+        size_t from = std::min<size_t>(r.first, ids.size());
+        size_t to = std::min(ids.size(), from + r.count);
+        return {ids.begin() + from, ids.begin() + to};
+    }
+
+    // [from, to) of the posting array covered by the groups a tree cursor yields, stopping once it
+    // spans need ids. The groups in a key range are consecutive, so only the outermost ones matter.
+    template <typename Cursor>
+    std::pair<size_t, size_t> groupSpan(Cursor c, size_t need) const {
+        size_t from = ids.size(), to = 0;
+        for (; c.valid(); c.next()) {
+            const PostingRange& r = c.value();
+            from = std::min<size_t>(from, r.first);
+            to = std::max<size_t>(to, static_cast<size_t>(r.first) + r.count);
+            if (to - from >= need) break;
+        }
+        to = std::min(to, ids.size()); // a damaged file can't send us past the array
+        if (from >= to) return {0, 0};
+        return {from, to};
+    }
+
+    Tree tree;
+    std::vector<uint32_t> ids;
+    Record* base;
+};
+
+#endif //POSTINGINDEX_H
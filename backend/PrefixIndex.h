@@ -0,0 +1,85 @@
+#ifndef PREFIXINDEX_H
+#define PREFIXINDEX_H
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Autocomplete over upper-cased names and symbols: a sorted string table (all strings packed into
+// one blob, fixed-size entries pointing into it). Every string starting with a prefix sits in one
+// contiguous run of entries, found by binary search; the run is then ranked by asset weight.
+class PrefixIndex {
+    struct Entry {
+        uint32_t offset;
+        uint32_t length;
+        uint32_t asset;
+    };
+    std::string blob;
+    std::vector<Entry> entries; // sorted by string
+    std::vector<uint32_t> weights; // asset -> rank weight, higher first
+
+    std::string_view text(const Entry& e) const { return std::string_view(blob).substr(e.offset, e.length); }
+
+public:
+    // keys are (upper-cased string, asset id); an asset may appear under several strings
+    void build(const std::vector<std::pair<std::string_view, uint32_t>>& keys, std::vector<uint32_t> assetWeights) {
+        blob.clear();
+        entries.clear();
+        size_t bytes = 0;
+        for (const auto& k : keys) bytes += k.first.size();
+        blob.reserve(bytes);
+        entries.reserve(keys.size());
+        for (const auto& k : keys) {
+            if (k.first.empty()) continue;
+            entries.push_back(Entry{static_cast<uint32_t>(blob.size()), static_cast<uint32_t>(k.first.size()), k.second});
+            blob.append(k.first);
+        }
+        std::sort(entries.begin(), entries.end(), [this](const Entry& a, const Entry& b) {
+            std::string_view x = text(a), y = text(b);
+            return x < y || (x == y && a.asset < b.asset);
+        });
+        weights = std::move(assetWeights);
+    }
+
+    // the k heaviest distinct assets with a string starting with prefix (case-insensitive); ties go
+    // to the alphabetically first match
+    std::vector<uint32_t> topK(std::string_view prefix, size_t k) const {
+        std::string p(prefix);
+        for (auto& c : p) c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+        auto first = std::lower_bound(entries.begin(), entries.end(), p, [this](const Entry& e, const std::string& key) {
+            return text(e) < key;
+        });
+        // one pass over the run keeping the best k so far, ordered by weight then string order. The
+        // run is read in string order, so a later hit only gets in with a strictly larger weight, and
+        // a second string of an asset already kept (same weight, later) never does.
+        std::vector<std::pair<uint32_t, uint32_t>> best; // (weight, asset), at most k
+        if (k == 0) return {};
+        best.reserve(k);
+        for (auto it = first; it != entries.end(); ++it) {
+            std::string_view s = text(*it);
+            if (s.compare(0, p.size(), p) != 0) break;
+            uint32_t w = it->asset < weights.size() ? weights[it->asset] : 0;
+            if (best.size() == k && w <= best.back().first) continue;
+            bool kept = false;
+            for (const auto& b : best) kept = kept || b.second == it->asset;
+            if (kept) continue;
+            auto at = std::upper_bound(best.begin(), best.end(), w, [](uint32_t x, const auto& b) { return x > b.first; });
+            best.insert(at, {w, it->asset});
+            if (best.size() > k) best.pop_back();
+        }
+        std::vector<uint32_t> out;
+        out.reserve(best.size());
+        for (const auto& b : best) out.push_back(b.second);
+        return out;
+    }
+
+    size_t size() const { return entries.size(); }
+    size_t approxBytes() const {
+        return blob.capacity() + entries.capacity() * sizeof(Entry) + weights.capacity() * sizeof(uint32_t);
+    }
+};
+
+#endif //PREFIXINDEX_H
@@ -0,0 +1,91 @@
+#ifndef SERIALIZE_H
+#define SERIALIZE_H
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <type_traits>
+
+// raw little helpers shared by the tree (de)serializers, values are written in host byte order
+template <typename T>
+inline void writePod(std::ostream& out, const T& v) {
+    out.write(reinterpret_cast<const char*>(&v), sizeof(T));
+}
+template <typename T>
+inline void writePods(std::ostream& out, const T* v, size_t n) {
+    out.write(reinterpret_cast<const char*>(v), static_cast<std::streamsize>(n * sizeof(T)));
+}
+
+// bounds-checked reader over a mapped buffer, every read fails once the buffer runs out
+class ByteReader {
+    const char* cur;
+    const char* end;
+public:
+    ByteReader(const char* begin, const char* end) : cur(begin), end(end) {}
+    template <typename T>
+    bool read(T& v) { return readN(&v, 1); }
+    template <typename T>
+    bool readN(T* v, size_t n) {
+        size_t bytes = n * sizeof(T);
+        if (static_cast<size_t>(end - cur) < bytes) return false;
+        if (bytes != 0) std::memcpy(v, cur, bytes); // empty vectors may hand us a null v
+        cur += bytes;
+        return true;
+    }
+    bool skip(size_t bytes) {
+        if (static_cast<size_t>(end - cur) < bytes) return false;
+        cur += bytes;
+        return true;
+    }
+    const char* pos() const { return cur; }
+};
+
+// record pointers are persisted as their position in the contiguous record store
+static const uint32_t kNoRecord = 0xFFFFFFFFu;
+
+template <typename Record>
+inline uint32_t recordToId(const Record* r, const Record* base) {
+    return r ? static_cast<uint32_t>(r - base) : kNoRecord;
+}
+template <typename Record>
+inline bool idToRecord(uint32_t id, Record* base, size_t count, Record*& out) {
+    if (id == kNoRecord) { out = nullptr; return true; }
+    if (id >= count) return false;
+    out = base + id;
+    return true;
+}
+
+// tree values on disk: record pointers become uint32 ids, any other (trivially copyable) value
+// type is written as raw bytes
+template <typename Value, typename Record>
+inline void writeValues(std::ostream& out, const Value* values, int n, const Record* base) {
+    if constexpr (std::is_pointer_v<Value>) {
+        for (int i = 0; i < n; i++) {
+            writePod<uint32_t>(out, recordToId<Record>(values[i], base));
+        }
+    } else {
+        writePods(out, values, static_cast<size_t>(n));
+    }
+}
+template <typename Value, typename Record>
+inline bool readValues(ByteReader& in, Value* values, int n, Record* base, size_t count) {
+    if constexpr (std::is_pointer_v<Value>) {
+        for (int i = 0; i < n; i++) {
+            uint32_t id;
+            if (!in.read(id) || !idToRecord(id, base, count, values[i])) return false;
+        }
+        return true;
+    } else {
+        return in.readN(values, static_cast<size_t>(n));
+    }
+}
+
+// every serialized tree starts with its shape so a file from a build with another key type or
+// fanout is rejected instead of misread
+struct TreeShape {
+    uint32_t keyBytes;
+    uint32_t valueBytes;
+    uint32_t order;
+    bool operator==(const TreeShape& o) const { return keyBytes == o.keyBytes && valueBytes == o.valueBytes && order == o.order; }
+};
+
+#endif //SERIALIZE_H
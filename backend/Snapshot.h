@@ -0,0 +1,513 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include "BTree.h"
+#include "MappedFile.h"
+#include "Serialize.h"
+
+// Binary columnar copy of the loaded records. Written once after a CSV load and mmapped on
+// later starts so the engine can skip parsing entirely. Layout (all sections 8-byte aligned):
+//   SnapshotHeader
+//   epochMs int64[rows] | priceTicks int64[rows] | price, high, low, volume double[rows]
+//   nameId, symbolId, typeId uint32[rows]
+//   timestamp offsets uint64[rows+1] + bytes
+//   name, symbol, type dictionaries: offsets uint64[count+1] + bytes each
+// The header carries a fingerprint of the source CSVs; a mismatch means the snapshot is stale.
+
+static const char kSnapshotMagic[8] = {'M', 'K', 'T', 'S', 'N', 'A', 'P', '\0'};
+static const uint32_t kSnapshotVersion = 4; // 2: epoch column holds milliseconds, 3: ticks rounded to the cent, 4: corrections kept out (CorrectionLog)
+
+enum SnapshotSection {
+    SEC_EPOCH, SEC_TICKS, SEC_PRICE, SEC_HIGH, SEC_LOW, SEC_VOLUME,
+    SEC_NAME_ID, SEC_SYMBOL_ID, SEC_TYPE_ID,
+    SEC_TS_OFFSETS, SEC_TS_BYTES,
+    SEC_NAME_OFFSETS, SEC_NAME_BYTES,
+    SEC_SYMBOL_OFFSETS, SEC_SYMBOL_BYTES,
+    SEC_TYPE_OFFSETS, SEC_TYPE_BYTES,
+    SEC_COUNT
+};
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerBytes;
+    uint64_t sourceFingerprint;
+    uint64_t rows;
+    uint64_t nameCount;
+    uint64_t symbolCount;
+    uint64_t typeCount;
+    uint64_t fileBytes;
+    uint64_t offset[SEC_COUNT]; // byte offset of each section from the start of the file
+};
+
+// 64-bit mix over 8-byte words (tail bytes folded in last), good enough to notice a changed file
+static uint64_t hashBytes64(const char* data, size_t n, uint64_t h = 0x9E3779B97F4A7C15ULL) {
+    const uint64_t mul = 0xFF51AFD7ED558CCDULL;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint64_t w;
+        std::memcpy(&w, data + i, 8);
+        h = (h ^ w) * mul;
+        h ^= h >> 32;
+    }
+    for (; i < n; i++) {
+        h = (h ^ static_cast<unsigned char>(data[i])) * mul;
+    }
+    h ^= h >> 29;
+    return h;
+}
+
+// Fingerprint of the source files: size, mtime and a hash of 64 evenly spaced 64KB blocks
+// (whole file when it is small). Cheap enough to run on every start, unlike hashing GBs of CSV.
+static uint64_t sourceFingerprint(const std::vector<std::string>& paths) {
+    const size_t block = 64 * 1024;
+    const size_t samples = 64;
+    uint64_t h = kSnapshotVersion;
+    for (const auto& path : paths) {
+        std::error_code ec;
+        auto size = std::filesystem::file_size(path, ec);
+        if (ec) { h = hashBytes64("missing", 7, h); continue; }
+        auto mtime = std::filesystem::last_write_time(path, ec).time_since_epoch().count();
+        h = hashBytes64(reinterpret_cast<const char*>(&size), sizeof(size), h);
+        h = hashBytes64(reinterpret_cast<const char*>(&mtime), sizeof(mtime), h);
+
+        MappedFile file(path);
+        if (!file.isOpen()) continue;
+        if (file.size() <= block * samples) {
+            h = hashBytes64(file.data(), file.size(), h);
+        } else {
+            size_t stride = (file.size() - block) / (samples - 1);
+            for (size_t i = 0; i < samples; i++) {
+                h = hashBytes64(file.data() + i * stride, block, h);
+            }
+        }
+    }
+    return h;
+}
+
+// assigns dense ids to distinct strings in first-seen order
+class StringDictionary {
+    std::unordered_map<std::string_view, uint32_t> ids;
+    std::vector<std::string_view> strings;
+public:
+    uint32_t intern(std::string_view s) { // views must outlive the dictionary
+        auto it = ids.find(s);
+        if (it != ids.end()) return it->second;
+        uint32_t id = static_cast<uint32_t>(strings.size());
+        ids.emplace(s, id);
+        strings.push_back(s);
+        return id;
+    }
+    const std::vector<std::string_view>& values() const { return strings; }
+};
+
+class SnapshotWriter {
+    std::ofstream out;
+    uint64_t pos = 0;
+
+    void pad() {
+        static const char zeros[8] = {};
+        size_t rem = pos % 8;
+        if (rem) { out.write(zeros, 8 - rem); pos += 8 - rem; }
+    }
+public:
+    explicit SnapshotWriter(const std::string& path) : out(path, std::ios::binary | std::ios::trunc) {}
+    bool ok() const { return static_cast<bool>(out); }
+    uint64_t tell() const { return pos; }
+
+    void raw(const void* data, size_t bytes) {
+        out.write(static_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+        pos += bytes;
+    }
+    template <typename T>
+    uint64_t column(const std::vector<T>& v) { // returns the section offset
+        pad();
+        uint64_t at = pos;
+        raw(v.data(), v.size() * sizeof(T));
+        return at;
+    }
+    // offsets uint64[n+1] followed by the concatenated bytes, returns {offsetsAt, bytesAt}
+    template <typename Strings>
+    std::pair<uint64_t, uint64_t> strings(const Strings& values) {
+        std::vector<uint64_t> offs;
+        offs.reserve(values.size() + 1);
+        uint64_t total = 0;
+        offs.push_back(0);
+        for (const auto& s : values) { total += s.size(); offs.push_back(total); }
+        uint64_t offsAt = column(offs);
+        pad();
+        uint64_t bytesAt = pos;
+        for (const auto& s : values) raw(s.data(), s.size());
+        return {offsAt, bytesAt};
+    }
+    void rewriteHeader(const SnapshotHeader& h) {
+        out.seekp(0);
+        out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    }
+    void close() { out.close(); }
+};
+
+// writes to path.tmp and renames, so a crash mid-write never leaves a half snapshot behind
+static bool writeSnapshot(const std::string& path, const std::vector<MarketRecord>& records, uint64_t fingerprint) {
+    const size_t n = records.size();
+    StringDictionary names, symbols, types;
+    std::vector<int64_t> epoch(n), ticks(n);
+    std::vector<double> price(n), high(n), low(n), volume(n);
+    std::vector<uint32_t> nameId(n), symbolId(n), typeId(n);
+    std::vector<std::string_view> ts(n);
+    for (size_t i = 0; i < n; i++) {
+        const MarketRecord& r = records[i];
+        epoch[i] = r.epochMs;
+        ticks[i] = r.priceTicks;
+        price[i] = r.price;
+        high[i] = r.high;
+        low[i] = r.low;
+        volume[i] = r.volume;
+        nameId[i] = names.intern(r.name);
+        symbolId[i] = symbols.intern(r.symbol);
+        typeId[i] = types.intern(r.type);
+        ts[i] = r.timestamp;
+    }
+
+    std::string tmp = path + ".tmp";
+    SnapshotHeader h{};
+    {
+        SnapshotWriter w(tmp);
+        if (!w.ok()) return false;
+        w.raw(&h, sizeof(h)); // placeholder, filled in once the offsets are known
+        h.offset[SEC_EPOCH] = w.column(epoch);
+        h.offset[SEC_TICKS] = w.column(ticks);
+        h.offset[SEC_PRICE] = w.column(price);
+        h.offset[SEC_HIGH] = w.column(high);
+        h.offset[SEC_LOW] = w.column(low);
+        h.offset[SEC_VOLUME] = w.column(volume);
+        h.offset[SEC_NAME_ID] = w.column(nameId);
+        h.offset[SEC_SYMBOL_ID] = w.column(symbolId);
+        h.offset[SEC_TYPE_ID] = w.column(typeId);
+        std::tie(h.offset[SEC_TS_OFFSETS], h.offset[SEC_TS_BYTES]) = w.strings(ts);
+        std::tie(h.offset[SEC_NAME_OFFSETS], h.offset[SEC_NAME_BYTES]) = w.strings(names.values());
+        std::tie(h.offset[SEC_SYMBOL_OFFSETS], h.offset[SEC_SYMBOL_BYTES]) = w.strings(symbols.values());
+        std::tie(h.offset[SEC_TYPE_OFFSETS], h.offset[SEC_TYPE_BYTES]) = w.strings(types.values());
+
+        std::memcpy(h.magic, kSnapshotMagic, sizeof(h.magic));
+        h.version = kSnapshotVersion;
+        h.headerBytes = sizeof(SnapshotHeader);
+        h.sourceFingerprint = fingerprint;
+        h.rows = n;
+        h.nameCount = names.values().size();
+        h.symbolCount = symbols.values().size();
+        h.typeCount = types.values().size();
+        h.fileBytes = w.tell();
+        w.rewriteHeader(h);
+        w.close();
+        if (!w.ok()) { std::remove(tmp.c_str()); return false; }
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmp, path, ec);
+    return !ec;
+}
+
+// read-only view over a mapped snapshot file
+class SnapshotView {
+    MappedFile file;
+    const SnapshotHeader* h = nullptr;
+
+    template <typename T>
+    const T* col(SnapshotSection s) const { return reinterpret_cast<const T*>(file.data() + h->offset[s]); }
+    std::string_view str(SnapshotSection offs, SnapshotSection bytes, uint64_t i) const {
+        const uint64_t* o = col<uint64_t>(offs);
+        return std::string_view(file.data() + h->offset[bytes] + o[i], o[i + 1] - o[i]);
+    }
+
+    // count elements of elemBytes each starting at section s lie inside the file (and are aligned)
+    bool fits(SnapshotSection s, uint64_t count, uint64_t elemBytes) const {
+        uint64_t at = h->offset[s];
+        if (at % 8 != 0 || at > file.size()) return false;
+        return count <= (file.size() - at) / elemBytes;
+    }
+    // offsets uint64[count+1] start at 0, never go down, and end inside the bytes section
+    bool stringsFit(SnapshotSection offs, SnapshotSection bytes, uint64_t count) const {
+        if (count == UINT64_MAX || !fits(offs, count + 1, sizeof(uint64_t)) || h->offset[bytes] > file.size()) return false;
+        const uint64_t* o = col<uint64_t>(offs);
+        if (o[0] != 0) return false;
+        for (uint64_t i = 0; i < count; i++) {
+            if (o[i + 1] < o[i]) return false;
+        }
+        return o[count] <= file.size() - h->offset[bytes];
+    }
+    // every id in the column names an entry of a dictionary with count strings
+    bool idsFit(SnapshotSection ids, uint64_t count) const {
+        const uint32_t* id = col<uint32_t>(ids);
+        for (uint64_t i = 0; i < h->rows; i++) {
+            if (id[i] >= count) return false;
+        }
+        return true;
+    }
+    bool bodyFits() const {
+        const uint64_t rows = h->rows;
+        for (SnapshotSection s : {SEC_EPOCH, SEC_TICKS, SEC_PRICE, SEC_HIGH, SEC_LOW, SEC_VOLUME}) {
+            if (!fits(s, rows, 8)) return false;
+        }
+        for (SnapshotSection s : {SEC_NAME_ID, SEC_SYMBOL_ID, SEC_TYPE_ID}) {
+            if (!fits(s, rows, sizeof(uint32_t))) return false;
+        }
+        return stringsFit(SEC_TS_OFFSETS, SEC_TS_BYTES, rows) &&
+               stringsFit(SEC_NAME_OFFSETS, SEC_NAME_BYTES, h->nameCount) &&
+               stringsFit(SEC_SYMBOL_OFFSETS, SEC_SYMBOL_BYTES, h->symbolCount) &&
+               stringsFit(SEC_TYPE_OFFSETS, SEC_TYPE_BYTES, h->typeCount) &&
+               idsFit(SEC_NAME_ID, h->nameCount) && idsFit(SEC_SYMBOL_ID, h->symbolCount) && idsFit(SEC_TYPE_ID, h->typeCount);
+    }
+public:
+    // false if the file is missing, from another format version, truncated, built from other sources,
+    // or has a section or string running past the end of the file
+    bool open(const std::string& path, uint64_t fingerprint) {
+        if (!file.open(path) || file.size() < sizeof(SnapshotHeader)) return false;
+        h = reinterpret_cast<const SnapshotHeader*>(file.data());
+        if (std::memcmp(h->magic, kSnapshotMagic, sizeof(h->magic)) != 0 || h->version != kSnapshotVersion ||
+            h->headerBytes != sizeof(SnapshotHeader) || h->fileBytes != file.size() ||
+            h->sourceFingerprint != fingerprint) {
+            h = nullptr;
+            return false;
+        }
+        if (!bodyFits()) {
+            h = nullptr;
+            return false;
+        }
+        return true;
+    }
+    uint64_t rows() const { return h ? h->rows : 0; }
+
+    int64_t epoch(uint64_t i) const { return col<int64_t>(SEC_EPOCH)[i]; }
+    int64_t priceTicks(uint64_t i) const { return col<int64_t>(SEC_TICKS)[i]; }
+    double price(uint64_t i) const { return col<double>(SEC_PRICE)[i]; }
+    double high(uint64_t i) const { return col<double>(SEC_HIGH)[i]; }
+    double low(uint64_t i) const { return col<double>(SEC_LOW)[i]; }
+    double volume(uint64_t i) const { return col<double>(SEC_VOLUME)[i]; }
+    std::string_view timestamp(uint64_t i) const { return str(SEC_TS_OFFSETS, SEC_TS_BYTES, i); }
+    std::string_view name(uint64_t i) const { return nameAt(nameId(i)); }
+    std::string_view symbol(uint64_t i) const { return symbolAt(symbolId(i)); }
+    std::string_view type(uint64_t i) const { return str(SEC_TYPE_OFFSETS, SEC_TYPE_BYTES, col<uint32_t>(SEC_TYPE_ID)[i]); }
+
+    // the name and symbol dictionaries (distinct strings in first-seen order) and each row's entry in them
+    uint64_t nameCount() const { return h ? h->nameCount : 0; }
+    uint64_t symbolCount() const { return h ? h->symbolCount : 0; }
+    std::string_view nameAt(uint64_t id) const { return str(SEC_NAME_OFFSETS, SEC_NAME_BYTES, id); }
+    std::string_view symbolAt(uint64_t id) const { return str(SEC_SYMBOL_OFFSETS, SEC_SYMBOL_BYTES, id); }
+    uint32_t nameId(uint64_t i) const { return col<uint32_t>(SEC_NAME_ID)[i]; }
+    uint32_t symbolId(uint64_t i) const { return col<uint32_t>(SEC_SYMBOL_ID)[i]; }
+};
+
+// opens the snapshot and fills the record vector from it, false if it is unusable (caller falls back
+// to the CSVs). Nothing is copied out of the file: the records' text points into snap's string
+// tables, so snap has to stay open for as long as the records are used.
+static bool loadSnapshot(SnapshotView& snap, const std::string& path, uint64_t fingerprint, std::vector<MarketRecord>& records) {
+    if (!snap.open(path, fingerprint)) return false;
+    records.clear();
+    records.reserve(snap.rows());
+    for (uint64_t i = 0; i < snap.rows(); i++) {
+        records.emplace_back(snap.timestamp(i), snap.name(i), snap.symbol(i), snap.price(i), snap.high(i), snap.low(i),
+                             snap.volume(i), snap.type(i));
+        records.back().epochMs = snap.epoch(i);
+        records.back().priceTicks = snap.priceTicks(i);
+    }
+    return true;
+}
+
+// Corrections made since the snapshot was written. They go to a file of their own, one small append
+// each, instead of into a rewritten snapshot; a start replays them over the loaded records. An entry
+// holds a row's corrected timestamp and price as whole values (replaying twice changes nothing) and
+// a checksum, so a torn last entry from a crash is found and dropped. The file is tied to the
+// sources' fingerprint like the snapshot. stamp() is that fingerprint chained through every entry;
+// index files carry it, so one written before the latest correction no longer loads.
+static const char kCorrectionMagic[8] = {'M', 'K', 'T', 'F', 'I', 'X', '\0', '\0'};
+static const uint32_t kCorrectionVersion = 1;
+
+struct CorrectionLogHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t unused;
+    uint64_t sourceFingerprint;
+};
+
+struct CorrectionEntry { // followed by the timestamp text and a checksum of both
+    uint64_t row;
+    int64_t epochMs;
+    int64_t priceTicks;
+    double price;
+    uint64_t timestampBytes;
+};
+
+class CorrectionLog {
+public:
+    // applies path's entries to records, in order; a log for other sources is dropped, and so is
+    // everything from the first damaged entry on. Returns how many entries were applied.
+    size_t replay(const std::string& logPath, uint64_t fingerprint, std::vector<MarketRecord>& records) {
+        path = logPath;
+        chain = fingerprint;
+        goodBytes = 0;
+        text.clear();
+        size_t applied = 0;
+        uint64_t fileBytes = 0;
+        {
+            MappedFile file(path);
+            if (!file.isOpen()) return 0;
+            fileBytes = file.size();
+            ByteReader in(file.data(), file.data() + file.size());
+            CorrectionLogHeader h{};
+            if (!in.read(h) || std::memcmp(h.magic, kCorrectionMagic, sizeof(h.magic)) != 0 || h.version != kCorrectionVersion ||
+                h.sourceFingerprint != fingerprint) {
+                return 0; // the first append starts the file over
+            }
+            goodBytes = sizeof(h);
+            CorrectionEntry e{};
+            while (in.read(e)) {
+                const char* ts = in.pos();
+                uint64_t sum = 0;
+                if (e.row >= records.size() || e.timestampBytes > 64 || !in.skip(static_cast<size_t>(e.timestampBytes)) ||
+                    !in.read(sum) || sum != checksum(e, std::string_view(ts, static_cast<size_t>(e.timestampBytes)))) {
+                    break;
+                }
+                MarketRecord& r = records[e.row];
+                r.epochMs = e.epochMs;
+                r.priceTicks = e.priceTicks;
+                r.price = e.price;
+                r.timestamp = keep(std::string(ts, static_cast<size_t>(e.timestampBytes)));
+                chain = hashBytes64(reinterpret_cast<const char*>(&sum), sizeof(sum), chain);
+                goodBytes = static_cast<uint64_t>(in.pos() - file.data());
+                applied++;
+            }
+        }
+        std::error_code ec;
+        if (fileBytes > goodBytes) std::filesystem::resize_file(path, goodBytes, ec); // cut off a torn tail
+        return applied;
+    }
+
+    // appends a corrected row as it is now and moves stamp() on; false if it could not be written
+    bool append(const MarketRecord& r, uint64_t row, uint64_t fingerprint) {
+        CorrectionEntry e{row, r.epochMs, r.priceTicks, r.price, r.timestamp.size()};
+        uint64_t sum = checksum(e, r.timestamp);
+        if (goodBytes == 0) { // no usable log yet
+            std::ofstream out(path, std::ios::binary | std::ios::trunc);
+            CorrectionLogHeader h{};
+            std::memcpy(h.magic, kCorrectionMagic, sizeof(h.magic));
+            h.version = kCorrectionVersion;
+            h.sourceFingerprint = fingerprint;
+            out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+            if (!out) return false;
+            goodBytes = sizeof(h);
+        }
+        std::ofstream out(path, std::ios::binary | std::ios::app);
+        out.write(reinterpret_cast<const char*>(&e), sizeof(e));
+        out.write(r.timestamp.data(), static_cast<std::streamsize>(r.timestamp.size()));
+        out.write(reinterpret_cast<const char*>(&sum), sizeof(sum));
+        out.flush();
+        if (!out) return false;
+        goodBytes += sizeof(e) + r.timestamp.size() + sizeof(sum);
+        chain = hashBytes64(reinterpret_cast<const char*>(&sum), sizeof(sum), chain);
+        return true;
+    }
+
+    uint64_t stamp() const { return chain; }
+    // holds text (a corrected timestamp) for the rest of the run, so records can point at it
+    std::string_view keep(std::string s) {
+        text.push_back(std::move(s));
+        return text.back();
+    }
+
+private:
+    static uint64_t checksum(const CorrectionEntry& e, std::string_view timestamp) {
+        return hashBytes64(timestamp.data(), timestamp.size(), hashBytes64(reinterpret_cast<const char*>(&e), sizeof(e)));
+    }
+
+    std::string path;
+    uint64_t chain = 0;
+    uint64_t goodBytes = 0; // length of the file up to its last intact entry, 0 when there is none
+    std::deque<std::string> text;
+};
+
+// Built indexes, persisted next to the record snapshot. Trees are stored back to back in the
+// order given; the header pins them to the record count and to the stamp of the records they were
+// built from (CorrectionLog::stamp, the source fingerprint while nothing was corrected), so ids and
+// keys stay valid.
+static const char kIndexMagic[8] = {'M', 'K', 'T', 'I', 'D', 'X', '\0', '\0'};
+static const uint32_t kIndexVersion = 3; // 2: name/timestamp indexes hold posting lists, 3: names keyed by catalog id
+
+struct IndexFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t treeCount;
+    uint64_t sourceFingerprint;
+    uint64_t recordCount;
+};
+
+template <typename... Trees>
+static bool writeIndexFile(const std::string& path, uint64_t fingerprint, const std::vector<MarketRecord>& store,
+                           const Trees&... trees) {
+    std::string tmp = path + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        if (!out) return false;
+        IndexFileHeader h{};
+        std::memcpy(h.magic, kIndexMagic, sizeof(h.magic));
+        h.version = kIndexVersion;
+        h.treeCount = sizeof...(Trees);
+        h.sourceFingerprint = fingerprint;
+        h.recordCount = store.size();
+        out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+        (trees.serialize(out, store.data()), ...);
+        out.close();
+        if (!out) { std::remove(tmp.c_str()); return false; }
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmp, path, ec);
+    return !ec;
+}
+
+// fills every tree from the index file, false (trees left empty) if it is missing, stale or damaged
+template <typename... Trees>
+static bool loadIndexFile(const std::string& path, uint64_t fingerprint, std::vector<MarketRecord>& store,
+                          Trees&... trees) {
+    MappedFile file(path);
+    if (!file.isOpen()) return false;
+    ByteReader in(file.data(), file.data() + file.size());
+    IndexFileHeader h{};
+    if (!in.read(h) || std::memcmp(h.magic, kIndexMagic, sizeof(h.magic)) != 0 || h.version != kIndexVersion ||
+        h.treeCount != sizeof...(Trees) || h.sourceFingerprint != fingerprint || h.recordCount != store.size()) {
+        return false;
+    }
+    bool ok = (trees.deserialize(in, store.data(), store.size()) && ...);
+    if (!ok || in.pos() != file.data() + file.size()) {
+        (trees.clear(), ...);
+        return false;
+    }
+    return true;
+}
+
+// moves an index file from one stamp to the next in place, for a correction that left its trees as
+// they were; false (file untouched) if it is not at stamp from
+static bool restampIndexFile(const std::string& path, uint64_t from, uint64_t to, size_t recordCount) {
+    std::fstream f(path, std::ios::in | std::ios::out | std::ios::binary);
+    IndexFileHeader h{};
+    if (!f || !f.read(reinterpret_cast<char*>(&h), sizeof(h)) || std::memcmp(h.magic, kIndexMagic, sizeof(h.magic)) != 0 ||
+        h.version != kIndexVersion || h.sourceFingerprint != from || h.recordCount != recordCount) {
+        return false;
+    }
+    h.sourceFingerprint = to;
+    f.seekp(0);
+    f.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    f.flush();
+    return static_cast<bool>(f);
+}
+
+#endif //SNAPSHOT_H
@@ -1,16 +1,27 @@
 #include <iostream>
 #include <fstream>
-#include <sstream>
 #include <vector>
 #include <string>
 #include <ctime>
-#include <iomanip>
 #include <algorithm>
 #include <chrono>
 #include <functional>
+#include <utility>
+#include <mutex>
 #include <map>
 #include <cctype>
 #include <filesystem>
+#include <string_view>
+#include <cstring>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <climits>
+#include <optional>
+#include <atomic>
+#include <thread>
+#include <condition_variable>
+#include <deque>
 
 #ifdef _WIN32
 #include <windows.h>
@@ -20,97 +31,391 @@
 #include "BTree.h"
 #include "BPlus.h"
 #include "json.hpp"
-
-using MyBPlusTree = BPlus;
+#include "MappedFile.h"
+#include "ThreadPool.h"
+#include "Snapshot.h"
+#include "PostingIndex.h"
+#include "NameCatalog.h"
+#include "PrefixIndex.h"
+#include "AggregateBPlus.h"
+#include "LearnedIndex.h"
+#include "AdaptiveRadixTree.h"
+#include "ConcurrentBPlus.h"
+
+// The engine's trees: 64-bit keys (epoch milliseconds, cents, catalog name id) pointing at records. Node
+// sizes come from the sweepFanout benchmark: 8 cache lines for the B-tree, 16 for the B+ tree.
+using TreeKey = int64_t;
+constexpr int kBTreeOrder = btreeOrderForBytes<TreeKey, MarketRecord*>(512);
+constexpr int kBPlusOrder = bplusOrderForBytes<TreeKey, MarketRecord*>(1024);
+using MyBTree     = BasicBTree<TreeKey, MarketRecord*, kBTreeOrder>;
+using MyBPlusTree = BasicBPlus<TreeKey, MarketRecord*, kBPlusOrder>;
+// wider keys must not bring padding back into the nodes
+static_assert(sizeof(BTreeNode<TreeKey, MarketRecord*, kBTreeOrder>) <= 512, "B-tree node outgrew its size");
+static_assert(sizeof(BPlusNode<TreeKey, MarketRecord*, kBPlusOrder>) <= 1024, "B+ tree node outgrew its size");
+// name and timestamp keys repeat across many rows, so those indexes keep one entry per distinct key
+// pointing at a posting list of record ids (same node size: a PostingRange is as wide as a pointer)
+static_assert(sizeof(PostingRange) == sizeof(MarketRecord*), "posting trees reuse the pointer-tree orders");
+using PostingBTree     = PostingIndex<BasicBTree<TreeKey, PostingRange, kBTreeOrder>, MarketRecord>;
+using PostingBPlusTree = PostingIndex<BasicBPlus<TreeKey, PostingRange, kBPlusOrder>, MarketRecord>;
+
+// composite key for per-ticker time series: name key first, then epoch milliseconds, so one
+// ticker's rows are adjacent in the leaves and already in time order
+struct NameTimeKey {
+    TreeKey name = 0;
+    TreeKey ms = 0;
+    friend bool operator==(const NameTimeKey& a, const NameTimeKey& b) { return a.name == b.name && a.ms == b.ms; }
+    friend bool operator!=(const NameTimeKey& a, const NameTimeKey& b) { return !(a == b); }
+    friend bool operator<(const NameTimeKey& a, const NameTimeKey& b) { return a.name < b.name || (a.name == b.name && a.ms < b.ms); }
+    friend bool operator>(const NameTimeKey& a, const NameTimeKey& b) { return b < a; }
+    friend bool operator<=(const NameTimeKey& a, const NameTimeKey& b) { return !(b < a); }
+    friend bool operator>=(const NameTimeKey& a, const NameTimeKey& b) { return !(a < b); }
+};
+constexpr int kNameTimeOrder = bplusOrderForBytes<NameTimeKey, MarketRecord*>(1024);
+using NameTimeBPlusTree = BasicBPlus<NameTimeKey, MarketRecord*, kNameTimeOrder>;
+static_assert(sizeof(BPlusNode<NameTimeKey, MarketRecord*, kNameTimeOrder>) <= 1024, "name/time node outgrew its size");
+
+// radix engine for the same keys: an adaptive radix tree in place of the B+ tree under the
+// posting list, so it answers exactly like the posting trees
+using PostingArt = PostingIndex<AdaptiveRadixTree<TreeKey, PostingRange>, MarketRecord>;
+// keys that also get the radix engine. A switched-off key's tree is neither built, saved nor timed,
+// and its queries and the perf snapshot leave the "art" entry out.
+constexpr bool kArtTimestamp = true;
+constexpr bool kArtPrice     = true;
+constexpr bool kArtName      = true;
+
+// third timestamp engine: a piecewise linear model over the sorted distinct timestamps in place of
+// inner nodes, same posting layout and result order as the posting trees
+using LearnedTimestampIndex = LearnedIndex<TreeKey, MarketRecord>;
+
+// min/max/sum/count of price per time window, answered from per-child summaries in the nodes
+struct PriceTicksOf {
+    int64_t operator()(const MarketRecord* p) const { return p->priceTicks; }
+};
+constexpr int kAggregateOrder = aggregateOrderForBytes<TreeKey>(1024);
+using PriceAggregateTree = AggregateBPlus<TreeKey, MarketRecord, PriceTicksOf, kAggregateOrder>;
+static_assert(sizeof(AggregateNode<TreeKey, kAggregateOrder>) <= 1024, "aggregate node outgrew its size");
+// live indexes: timestamp and price trees the ingest thread inserts into while queries read them
+// (no per-child counts, so the same node size holds a little more)
+constexpr int kLiveOrder = bplusOrderForBytes<TreeKey, MarketRecord*>(1024);
+using LiveBPlusTree = ConcurrentBPlus<TreeKey, MarketRecord*, kLiveOrder>;
+static_assert(sizeof(OlcNode<TreeKey, MarketRecord*, kLiveOrder>) <= 1024, "live node outgrew its size");
 int max_results = 500;
 using json = nlohmann::json;
 
-// 32-bit name key (FNV-1a over uppercased name)
-static uint32_t nameKey32(const std::string& name) {
-    const uint32_t FNV_OFFSET = 2166136261u;
-    const uint32_t FNV_PRIME  = 16777619u;
-    uint32_t hash = FNV_OFFSET;
-    for (unsigned char ch : name) {
-        unsigned char up = (unsigned char)std::toupper(ch);
-        hash ^= up;
-        hash *= FNV_PRIME;
-    }
-    return hash;
+// days since 1970-01-01 for a proleptic Gregorian date (Hinnant's days_from_civil)
+static constexpr int64_t daysFromCivil(int64_t y, unsigned m, unsigned d) {
+    y -= m <= 2;
+    const int64_t era = (y >= 0 ? y : y - 399) / 400;
+    const unsigned yoe = static_cast<unsigned>(y - era * 400);
+    const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + static_cast<int64_t>(doe) - 719468;
 }
 
+// reads exactly n digits at s[pos], false if any of them is not a digit
+static inline bool readDigits(std::string_view s, size_t pos, size_t n, unsigned& out) {
+    if (pos + n > s.size()) return false;
+    unsigned v = 0;
+    for (size_t i = pos; i < pos + n; i++) {
+        unsigned d = static_cast<unsigned>(s[i] - '0');
+        if (d > 9) return false;
+        v = v * 10 + d;
+    }
+    out = v;
+    return true;
+}
 
-static std::string to_upper(std::string s){ for (auto &c: s) c=(char)std::toupper((unsigned char)c); return s; }
-
-int timetoSeconds(const std::string& timestamp) {
-    std::tm tm = {};
-    std::stringstream ss(timestamp);
-    if (ss >> std::get_time(&tm, "%Y-%m-%d %H:%M:%S")) {
-        return static_cast<int>(std::mktime(&tm));
+// "YYYY-MM-DD[ HH:MM[:SS[.fff]]]" -> epoch milliseconds in UTC, 0 if the date part is malformed.
+// Fractions beyond milliseconds are dropped.
+int64_t timetoMillis(std::string_view timestamp) {
+    unsigned y, mo, d, h = 0, mi = 0, sec = 0, ms = 0;
+    if (timestamp.size() < 10 || timestamp[4] != '-' || timestamp[7] != '-' ||
+        !readDigits(timestamp, 0, 4, y) || !readDigits(timestamp, 5, 2, mo) || !readDigits(timestamp, 8, 2, d)) {
+        return 0;
     }
-    std::tm tm2 = {};
-    std::stringstream ss2(timestamp + " 00:00:00");
-    if (ss2 >> std::get_time(&tm2, "%Y-%m-%d %H:%M:%S")) {
-        return static_cast<int>(std::mktime(&tm2));
+    if (mo < 1 || mo > 12 || d < 1 || d > 31) return 0;
+    // time part is optional; a date on its own means midnight
+    if (timestamp.size() >= 16 && (timestamp[10] == ' ' || timestamp[10] == 'T') && timestamp[13] == ':' &&
+        readDigits(timestamp, 11, 2, h) && readDigits(timestamp, 14, 2, mi)) {
+        if (timestamp.size() >= 19 && timestamp[16] == ':') {
+            if (!readDigits(timestamp, 17, 2, sec)) {
+                sec = 0;
+            } else if (timestamp.size() > 20 && (timestamp[19] == '.' || timestamp[19] == ',')) {
+                unsigned scale = 100;
+                for (size_t i = 20; i < timestamp.size() && scale > 0; i++, scale /= 10) {
+                    unsigned dig = static_cast<unsigned>(timestamp[i] - '0');
+                    if (dig > 9) break;
+                    ms += dig * scale;
+                }
+            }
+        }
+    } else {
+        h = mi = 0;
     }
-    return 0;
+    return (daysFromCivil(y, mo, d) * 86400 + h * 3600 + mi * 60 + sec) * 1000 + ms;
 }
-int priceToInt(double price) { return static_cast<int>(price * 100); }
-
 // Sequential scan helpers
-static double scanTickerSec(const std::vector<MarketRecord*>& recs, const std::string& qUpper) {
+static volatile size_t scanSink; // the match counts land here so the loops can't be optimized away
+static double scanTickerSec(const std::vector<MarketRecord*>& recs, uint32_t nameId, size_t offset = 0) {
     auto s = std::chrono::high_resolution_clock::now();
-    uint32_t key = nameKey32(qUpper);
     size_t seen = 0;
     for (auto* p : recs) {
         if (!p) continue;
-        if (nameKey32(to_upper(p->name)) == key) {
-            if (++seen >= (size_t)max_results) break;
+        if (p->nameId == nameId) {
+            if (++seen >= offset + (size_t)max_results) break;
         }
     }
+    scanSink = seen;
     auto e = std::chrono::high_resolution_clock::now();
     return std::chrono::duration<double>(e - s).count();
 }
 
-static double scanDateRangeSec(const std::vector<MarketRecord*>& recs, int lo, int hi) {
+static double scanDateRangeSec(const std::vector<MarketRecord*>& recs, int64_t lo, int64_t hi, size_t offset = 0) {
     auto s = std::chrono::high_resolution_clock::now();
     size_t seen = 0;
     for (auto* p : recs) {
         if (!p) continue;
-        int t = timetoSeconds(p->timestamp);
+        int64_t t = p->epochMs;
         if (t >= lo && t <= hi) {
-            if (++seen >= (size_t)max_results) break;
+            if (++seen >= offset + (size_t)max_results) break;
+        }
+    }
+    scanSink = seen;
+    auto e = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double>(e - s).count();
+}
+
+static double scanTickerRangeSec(const std::vector<MarketRecord*>& recs, uint32_t nameId, int64_t lo, int64_t hi, size_t offset = 0) {
+    auto s = std::chrono::high_resolution_clock::now();
+    size_t seen = 0;
+    for (auto* p : recs) {
+        if (!p) continue;
+        if (p->epochMs >= lo && p->epochMs <= hi && p->nameId == nameId) {
+            if (++seen >= offset + (size_t)max_results) break;
         }
     }
+    scanSink = seen;
     auto e = std::chrono::high_resolution_clock::now();
     return std::chrono::duration<double>(e - s).count();
 }
 
-static double scanPriceRangeSec(const std::vector<MarketRecord*>& recs, int lo, int hi) {
+static double scanPriceRangeSec(const std::vector<MarketRecord*>& recs, int64_t lo, int64_t hi, size_t offset = 0) {
     auto s = std::chrono::high_resolution_clock::now();
     size_t seen = 0;
     for (auto* p : recs) {
         if (!p) continue;
-        int v = priceToInt(p->price);
+        int64_t v = p->priceTicks;
         if (v >= lo && v <= hi) {
-            if (++seen >= (size_t)max_results) break;
+            if (++seen >= offset + (size_t)max_results) break;
         }
     }
+    scanSink = seen;
     auto e = std::chrono::high_resolution_clock::now();
     return std::chrono::duration<double>(e - s).count();
 }
 
-std::vector<std::string> splitCSVLine(const std::string& line) {
-    std::vector<std::string> result;
-    std::stringstream ss(line);
-    std::string field;
-    while (std::getline(ss, field, ',')) {
-        size_t start = field.find_first_not_of(" \t\r\n");
-        size_t end = field.find_last_not_of(" \t\r\n");
-        if (start != std::string::npos) field = field.substr(start, end - start + 1);
-        else field.clear();
-        result.push_back(field);
-    }
-    return result;
+// a count has to look at every record
+template <typename Match>
+static double scanCountSec(const std::vector<MarketRecord*>& recs, Match match, size_t& count) {
+    auto s = std::chrono::high_resolution_clock::now();
+    size_t seen = 0;
+    for (auto* p : recs) {
+        if (p && match(p)) seen++;
+    }
+    scanSink = seen;
+    count = seen;
+    auto e = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double>(e - s).count();
+}
+
+// price aggregate of every matching record
+template <typename Match>
+static double scanAggregateSec(const std::vector<MarketRecord*>& recs, Match match, RangeAggregate& agg) {
+    auto s = std::chrono::high_resolution_clock::now();
+    RangeAggregate a;
+    for (auto* p : recs) {
+        if (p && match(p)) a.add(p->priceTicks);
+    }
+    scanSink = a.count;
+    agg = a;
+    auto e = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double>(e - s).count();
+}
+
+// a "last n" page has no early exit for a scan: every match is kept and the top of them sorted by key
+template <typename Match, typename KeyOf>
+static double scanLastSec(const std::vector<MarketRecord*>& recs, Match match, KeyOf keyOf, size_t offset = 0) {
+    auto s = std::chrono::high_resolution_clock::now();
+    std::vector<const MarketRecord*> hits;
+    for (auto* p : recs) {
+        if (p && match(p)) hits.push_back(p);
+    }
+    size_t n = std::min(hits.size(), offset + (size_t)max_results);
+    std::partial_sort(hits.begin(), hits.begin() + n, hits.end(),
+                      [&](const MarketRecord* a, const MarketRecord* b) { return keyOf(a) > keyOf(b); });
+    scanSink = n;
+    auto e = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double>(e - s).count();
+}
+
+// trims spaces/CR around a field without copying it
+static std::string_view trimField(std::string_view field) {
+    size_t start = field.find_first_not_of(" \t\r\n");
+    if (start == std::string_view::npos) return std::string_view();
+    size_t end = field.find_last_not_of(" \t\r\n");
+    return field.substr(start, end - start + 1);
+}
+
+// splits one CSV line in place, views point into the mapped file (returns number of fields found)
+static size_t splitCSVLine(std::string_view line, std::string_view* fields, size_t maxFields) {
+    size_t n = 0;
+    size_t pos = 0;
+    while (n < maxFields) {
+        size_t comma = line.find(',', pos);
+        if (comma == std::string_view::npos) {
+            if (pos < line.size() || n > 0) fields[n++] = trimField(line.substr(pos));
+            break;
+        }
+        fields[n++] = trimField(line.substr(pos, comma - pos));
+        pos = comma + 1;
+    }
+    return n;
+}
+
+// data lines of a CSV file, i.e. everything after the header line
+static std::string_view csvBody(std::string_view file) {
+    size_t nl = file.find('\n');
+    return nl == std::string_view::npos ? std::string_view() : file.substr(nl + 1);
+}
+
+// walks the lines of a CSV chunk, calls onLine for each non-empty line until it returns false
+template <typename F>
+static void forEachCSVLine(std::string_view lines, F&& onLine) {
+    size_t pos = 0;
+    while (pos < lines.size()) {
+        const char* nl = static_cast<const char*>(std::memchr(lines.data() + pos, '\n', lines.size() - pos));
+        size_t end = nl ? static_cast<size_t>(nl - lines.data()) : lines.size();
+        std::string_view line = lines.substr(pos, end - pos);
+        pos = end + 1;
+        if (line.empty()) continue;
+        if (!onLine(line)) return;
+    }
+}
+
+// cuts a CSV body into roughly equal pieces that each end on a line boundary
+static std::vector<std::string_view> splitCSVChunks(std::string_view body, size_t pieces) {
+    const size_t minChunk = 1 << 20; // not worth a task below ~1MB
+    std::vector<std::string_view> chunks;
+    if (pieces == 0) pieces = 1;
+    size_t target = std::max(minChunk, body.size() / pieces + 1);
+    size_t pos = 0;
+    while (pos < body.size()) {
+        size_t end = std::min(body.size(), pos + target);
+        if (end < body.size()) {
+            size_t nl = body.find('\n', end);
+            end = (nl == std::string_view::npos) ? body.size() : nl + 1;
+        }
+        chunks.push_back(body.substr(pos, end - pos));
+        pos = end;
+    }
+    return chunks;
+}
+
+static constexpr double kPow10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+static constexpr int64_t kIPow10[] = {1LL, 10LL, 100LL, 1000LL, 10000LL, 100000LL, 1000000LL, 10000000LL,
+                                      100000000LL, 1000000000LL, 10000000000LL, 100000000000LL,
+                                      1000000000000LL, 10000000000000LL, 100000000000000LL,
+                                      1000000000000000LL, 10000000000000000LL, 100000000000000000LL,
+                                      1000000000000000000LL};
+
+// the digits of a decimal (integer digits then fraction digits, point moved exp10 places right) as
+// whole cents, rounded half away from zero; saturates at the int64 range
+static int64_t centsFromDigits(const char* intBeg, int intDigits, const char* fracBeg, int fracDigits, int exp10, bool neg) {
+    auto digit = [&](int i) -> uint64_t {
+        if (i < 0 || i >= intDigits + fracDigits) return 0;
+        return static_cast<uint64_t>((i < intDigits ? intBeg[i] : fracBeg[i - intDigits]) - '0');
+    };
+    const uint64_t limit = static_cast<uint64_t>(INT64_MAX);
+    int point = intDigits + std::clamp(exp10, -64, 64) + 2; // digits in front of the cents point
+    uint64_t c = 0;
+    bool saturated = false;
+    for (int i = 0; i < point && !saturated; i++) {
+        uint64_t d = digit(i);
+        saturated = c > (limit - d) / 10;
+        if (!saturated) c = c * 10 + d;
+    }
+    if (!saturated && digit(point) >= 5) {
+        saturated = c == limit;
+        c++;
+    }
+    if (saturated) return neg ? INT64_MIN : INT64_MAX;
+    return neg ? -static_cast<int64_t>(c) : static_cast<int64_t>(c);
+}
+
+// decimal field -> double and fixed-point cents, no locale or allocation on the common path. The cents
+// come from the digits themselves (see centsFromDigits), never from the double.
+// like stod it reads the longest numeric prefix; false if there are no digits at all
+static bool parsePrice(std::string_view field, double& value, int64_t& ticks) {
+    const char* p = field.data();
+    const char* end = p + field.size();
+    auto digitRun = [end](const char* q) { while (q < end && static_cast<unsigned>(*q - '0') <= 9) ++q; return q; };
+
+    bool neg = false;
+    if (p < end && (*p == '-' || *p == '+')) { neg = (*p == '-'); ++p; }
+    const char* intEnd = digitRun(p);
+    const char* fracBeg = intEnd;
+    const char* fracEnd = intEnd;
+    if (intEnd < end && *intEnd == '.') { fracBeg = intEnd + 1; fracEnd = digitRun(fracBeg); }
+    if (intEnd == p && fracEnd == fracBeg) return false;
+
+    while (p < intEnd && *p == '0') ++p; // leading zeros don't count toward the 18 digits we can hold
+    int intDigits = static_cast<int>(intEnd - p);
+    int fracDigits = static_cast<int>(fracEnd - fracBeg);
+    int exp10 = 0;
+    const char* tail = fracEnd;
+    if (tail + 1 < end && (*tail == 'e' || *tail == 'E')) {
+        const char* e = tail + 1;
+        if (*e == '+') ++e;
+        int ev = 0;
+        if (std::from_chars(e, end, ev).ec == std::errc()) exp10 = ev;
+    }
+    ticks = centsFromDigits(p, intDigits, fracBeg, fracDigits, exp10, neg);
+
+    bool exact = intDigits + fracDigits <= 18;
+    if (intDigits <= 18) {
+        uint64_t ip = 0, fp = 0;
+        int keepFrac = std::min(fracDigits, 18 - intDigits);
+        if (intDigits > 0) std::from_chars(p, intEnd, ip);
+        if (keepFrac > 0) std::from_chars(fracBeg, fracBeg + keepFrac, fp);
+        uint64_t mant = ip * static_cast<uint64_t>(kIPow10[keepFrac]) + fp;
+        int scale = exp10 - keepFrac; // value == mant * 10^scale
+
+        if (exact && mant <= (1ULL << 53) && scale >= -22 && scale <= 22) {
+            value = scale < 0 ? static_cast<double>(mant) / kPow10[-scale] : static_cast<double>(mant) * kPow10[scale];
+            if (neg) value = -value;
+            return true;
+        }
+    }
+
+    // rare: too many significant digits or a huge exponent, let strtod do the correctly rounded conversion
+    value = std::strtod(std::string(field).c_str(), nullptr);
+    return true;
+}
+
+// query-side price -> cents by the loader's rule: the double is written out as the shortest decimal
+// that reads back as it (57084.3889 stays "57084.3889") and that text goes through parsePrice, so a
+// bound typed as a row's price lands on that row's tick. Prices past the int64 cent range, infinities
+// included, clamp to its ends (a bound of 1e20 still means "everything"); NaN has no tick and gives 0.
+int64_t priceToInt(double price) {
+    if (std::isnan(price)) return 0;
+    if (std::isinf(price)) return price > 0 ? INT64_MAX : INT64_MIN;
+    char buf[32];
+    char* end = std::to_chars(buf, buf + sizeof(buf), price).ptr;
+    double value;
+    int64_t ticks = 0;
+    parsePrice(std::string_view(buf, static_cast<size_t>(end - buf)), value, ticks);
+    return ticks;
 }
 
 // Live process memory
@@ -126,69 +431,98 @@ static double getProcessMemoryMB() {
 #endif
 }
 
-// Data loading
-std::vector<MarketRecord> loadStockData(const std::string& filename, int maxRows) {
-    std::vector<MarketRecord> records;
-    std::ifstream file(filename);
-    if (!file.is_open()) return records;
-
-    std::string line;
-    if (!std::getline(file, line)) return records; // header
-
+// Data loading (file is mmapped and tokenized in place; records keep views of their fields, so the
+// mapping has to outlive them)
+// parses up to maxRows stock rows out of one chunk of stocks.csv
+static void parseStockRows(std::string_view lines, int maxRows, std::vector<MarketRecord>& records) {
     int count = 0;
-    while (std::getline(file, line) && count < maxRows) {
-        if (line.empty()) continue;
-        auto fields = splitCSVLine(line);
-        if (fields.size() < 5) continue; // need timestamp,name,last,high,low
-        try {
-            std::string ts     = fields[0];
-            std::string name   = fields[1];
-            std::string symbol = "";
-            double price       = std::stod(fields[2]);
-            double high        = std::stod(fields[3]);
-            double low         = std::stod(fields[4]);
-            double volume      = 0.0;
-
-            records.emplace_back(ts, name, symbol, price, high, low, volume, "STOCK");
-            ++count;
-        } catch (...) { continue; }
-    }
-    return records;
+    std::string_view fields[5];
+    forEachCSVLine(lines, [&](std::string_view line) {
+        if (count >= maxRows) return false;
+        if (splitCSVLine(line, fields, 5) < 5) return true; // need timestamp,name,last,high,low
+        double price, high, low;
+        int64_t ticks, unused;
+        if (!parsePrice(fields[2], price, ticks) || !parsePrice(fields[3], high, unused) || !parsePrice(fields[4], low, unused)) {
+            return true;
+        }
+        records.emplace_back(fields[0], fields[1], "", price, high, low, 0.0, "STOCK");
+        records.back().epochMs = timetoMillis(fields[0]);
+        records.back().priceTicks = ticks;
+        ++count;
+        return true;
+    });
 }
 
 // CRYPTO.CSV headers
-std::vector<MarketRecord> loadCryptoData(const std::string& filename, int maxRows) {
+static void parseCryptoRows(std::string_view lines, int maxRows, std::vector<MarketRecord>& records) {
+    int count = 0;
+    std::string_view fields[4];
+    forEachCSVLine(lines, [&](std::string_view line) {
+        if (count >= maxRows) return false;
+        if (splitCSVLine(line, fields, 4) < 4) return true;
+        double price;
+        int64_t ticks;
+        if (!parsePrice(fields[3], price, ticks)) return true;
+        records.emplace_back(fields[0], fields[1], fields[2], price, 0.0, 0.0, 0.0, "CRYPTO");
+        records.back().epochMs = timetoMillis(fields[0]);
+        records.back().priceTicks = ticks;
+        ++count;
+        return true;
+    });
+}
+
+// single-threaded when pool is null, otherwise each chunk is parsed on the pool and the
+// per-chunk vectors are appended in file order so row order matches the sequential loader
+template <typename ParseRows>
+static std::vector<MarketRecord> loadCSV(const MappedFile& file, int maxRows, ThreadPool* pool, ParseRows parseRows) {
     std::vector<MarketRecord> records;
-    std::ifstream file(filename);
-    if (!file.is_open()) return records;
+    if (!file.isOpen()) return records;
+    std::string_view body = csvBody(file.view());
 
-    std::string line;
-    if (!std::getline(file, line)) return records; // header
+    if (pool == nullptr || pool->size() < 2) {
+        parseRows(body, maxRows, records);
+        return records;
+    }
 
-    int count = 0;
-    while (std::getline(file, line) && count < maxRows) {
-        if (line.empty()) continue;
-        auto fields = splitCSVLine(line);
-        if (fields.size() < 4) continue;
-        try {
-            std::string ts     = fields[0];
-            std::string name   = fields[1];
-            std::string symbol = fields[2];
-            double price       = std::stod(fields[3]);
-            double high        = 0.0;
-            double low         = 0.0;
-            double volume      = 0.0;
-
-            records.emplace_back(ts, name, symbol, price, high, low, volume, "CRYPTO");
-            ++count;
-        } catch (...) { continue; }
+    auto chunks = splitCSVChunks(body, pool->size() * 4);
+    std::vector<std::future<std::vector<MarketRecord>>> parts;
+    parts.reserve(chunks.size());
+    for (auto chunk : chunks) {
+        parts.push_back(pool->submit([chunk, maxRows, parseRows] {
+            std::vector<MarketRecord> part;
+            part.reserve(chunk.size() / 48); // rough bytes-per-row guess, just avoids regrowth
+            parseRows(chunk, maxRows, part);
+            return part;
+        }));
+    }
+
+    std::vector<std::vector<MarketRecord>> done;
+    done.reserve(parts.size());
+    size_t total = 0;
+    for (auto& f : parts) {
+        done.push_back(f.get());
+        total += done.back().size();
+    }
+    records.reserve(std::min(total, static_cast<size_t>(std::max(maxRows, 0))));
+    for (auto& part : done) {
+        for (auto& r : part) {
+            if (records.size() >= static_cast<size_t>(std::max(maxRows, 0))) return records;
+            records.push_back(std::move(r));
+        }
     }
     return records;
 }
 
+std::vector<MarketRecord> loadStockData(const MappedFile& file, int maxRows, ThreadPool* pool = nullptr) {
+    return loadCSV(file, maxRows, pool, parseStockRows);
+}
+
+std::vector<MarketRecord> loadCryptoData(const MappedFile& file, int maxRows, ThreadPool* pool = nullptr) {
+    return loadCSV(file, maxRows, pool, parseCryptoRows);
+}
+
 // Performance test helper
 struct PerformanceMetrics {
-    double buildTime{};
     double rangeQuery100{};
     double rangeQuery1000{};
     double rangeQuery10000{};
@@ -196,6 +530,34 @@ struct PerformanceMetrics {
     double memoryUsage{};
 };
 
+// wall time each index took to get ready (reload or bulk load), they are built side by side
+struct IndexBuildTimes {
+    double timestampBTree{}, priceBTree{}, nameBTree{};
+    double timestampBPlus{}, priceBPlus{}, nameBPlus{};
+    double nameTimeBPlus{};
+    double priceAggregate{};
+    double timestampLearned{};
+    double timestampArt{}, priceArt{}, nameArt{};
+    double timestampLive{}, priceLive{};
+    double wall{}; // all indexes, start to finish
+};
+
+// one engine's entry in the perf snapshot; indexes the tester does not time have no metrics
+struct PerfEntry {
+    const char* name;
+    double buildTime;
+    double memoryMB;
+    std::optional<PerformanceMetrics> metrics;
+    std::vector<std::pair<const char*, double>> extra; // engine-specific figures
+    PerfEntry(const char* name, double buildTime, double memoryMB, std::optional<PerformanceMetrics> metrics = std::nullopt)
+        : name(name), buildTime(buildTime), memoryMB(memoryMB), metrics(metrics) {}
+};
+// the engines answering one kind of key, e.g. "timestamp_index"
+struct PerfSection {
+    const char* name;
+    std::vector<PerfEntry> engines;
+};
+
 class PerformanceTester {
     static double measureTime(std::function<void()> func) {
         auto s = std::chrono::high_resolution_clock::now();
@@ -207,10 +569,10 @@ public:
     template <typename Tree>
     PerformanceMetrics testTimestamp(Tree& tree, const std::vector<MarketRecord*>& records) {
         PerformanceMetrics m;
-        m.rangeQuery100   = measureTime([&](){ auto r = tree.rangeQuery(timetoSeconds("2025-10-20 00:00:00"), timetoSeconds("2025-10-21 00:00:00")); });
-        m.rangeQuery1000  = measureTime([&](){ auto r = tree.rangeQuery(timetoSeconds("2025-10-01 00:00:00"), timetoSeconds("2025-10-08 00:00:00")); });
-        m.rangeQuery10000 = measureTime([&](){ auto r = tree.rangeQuery(timetoSeconds("2025-09-01 00:00:00"), timetoSeconds("2025-11-30 23:59:59")); });
-        m.exactLookup     = measureTime([&](){ if(!records.empty()){ auto r = tree.search(timetoSeconds(records[0]->timestamp)); (void)r; }});
+        m.rangeQuery100   = measureTime([&](){ auto r = tree.rangeQuery(timetoMillis("2025-10-20 00:00:00"), timetoMillis("2025-10-21 00:00:00")); });
+        m.rangeQuery1000  = measureTime([&](){ auto r = tree.rangeQuery(timetoMillis("2025-10-01 00:00:00"), timetoMillis("2025-10-08 00:00:00")); });
+        m.rangeQuery10000 = measureTime([&](){ auto r = tree.rangeQuery(timetoMillis("2025-09-01 00:00:00"), timetoMillis("2025-11-30 23:59:59")); });
+        m.exactLookup     = measureTime([&](){ if(!records.empty()){ auto r = tree.search(records[0]->epochMs); (void)r; }});
         m.memoryUsage     = 0.0;
         return m;
     }
@@ -220,10 +582,63 @@ public:
         m.rangeQuery100   = measureTime([&](){ auto r = tree.rangeQuery(priceToInt(100.0),  priceToInt(150.0)); });
         m.rangeQuery1000  = measureTime([&](){ auto r = tree.rangeQuery(priceToInt(0.0),    priceToInt(500.0)); });
         m.rangeQuery10000 = measureTime([&](){ auto r = tree.rangeQuery(priceToInt(0.0),    priceToInt(50000.0)); });
-        m.exactLookup     = measureTime([&](){ if(!records.empty()){ auto r = tree.search(priceToInt(records[0]->price)); (void)r; }});
+        m.exactLookup     = measureTime([&](){ if(!records.empty()){ auto r = tree.search(records[0]->priceTicks); (void)r; }});
         m.memoryUsage     = 0.0;
         return m;
     }
+
+    // Fanout sweep: bulk loads the timestamp index once per fanout and times the same workload on
+    // each (1000 sampled point lookups and a one-week range), so the node size can be picked from data
+    struct FanoutResult {
+        std::string tree;
+        int fanout{};
+        size_t nodeBytes{};
+        double buildSec{};
+        double exactLookup{}; // average per lookup
+        double rangeQuery1000{};
+        double memoryMB{};
+    };
+
+    template <int... BTreeOrders, int... BPlusOrders>
+    std::vector<FanoutResult> sweepFanout(const std::vector<MarketRecord*>& records,
+                                          std::integer_sequence<int, BTreeOrders...>,
+                                          std::integer_sequence<int, BPlusOrders...>) {
+        std::vector<std::pair<TreeKey, MarketRecord*>> entries;
+        entries.reserve(records.size());
+        for (auto* p : records) entries.emplace_back(p->epochMs, p);
+        std::sort(entries.begin(), entries.end());
+
+        std::vector<TreeKey> probes;
+        for (size_t i = 0; i < 1000 && !entries.empty(); i++) {
+            probes.push_back(entries[(i * 7919) % entries.size()].first);
+        }
+
+        std::vector<FanoutResult> out;
+        (out.push_back(measureFanout<BasicBTree<TreeKey, MarketRecord*, BTreeOrders>>(
+            "btree", BTreeOrders, sizeof(BTreeNode<TreeKey, MarketRecord*, BTreeOrders>), entries, probes)), ...);
+        (out.push_back(measureFanout<BasicBPlus<TreeKey, MarketRecord*, BPlusOrders>>(
+            "bplustree", BPlusOrders, sizeof(BPlusNode<TreeKey, MarketRecord*, BPlusOrders>), entries, probes)), ...);
+        return out;
+    }
+
+private:
+    template <typename Tree>
+    FanoutResult measureFanout(const char* name, int fanout, size_t nodeBytes,
+                               const std::vector<std::pair<TreeKey, MarketRecord*>>& entries, const std::vector<TreeKey>& probes) {
+        FanoutResult r;
+        r.tree = name;
+        r.fanout = fanout;
+        r.nodeBytes = nodeBytes;
+        Tree tree;
+        r.buildSec = measureTime([&](){ tree.bulkLoad(entries.begin(), entries.end()); });
+        size_t hits = 0;
+        double all = measureTime([&](){ for (TreeKey k : probes) hits += tree.search(k) != nullptr; });
+        r.exactLookup = probes.empty() ? 0.0 : all / static_cast<double>(probes.size());
+        r.rangeQuery1000 = measureTime([&](){ auto v = tree.rangeQuery(timetoMillis("2025-10-01 00:00:00"), timetoMillis("2025-10-08 00:00:00")); });
+        r.memoryMB = static_cast<double>(tree.approxBytes()) / (1024.0 * 1024.0);
+        (void)hits;
+        return r;
+    }
 };
 
 static std::string isoNow() {
@@ -242,102 +657,377 @@ static std::string isoNow() {
 }
 
 // Persist perf snapshot for static table
-static void writePerfJSON(
-    const std::string& outPath,
-    const PerformanceMetrics& tsBT,
-    const PerformanceMetrics& prBT,
-    const PerformanceMetrics& tsBP,
-    const PerformanceMetrics& prBP,
-    double mem_tsBT_mb,
-    double mem_tsBP_mb,
-    double mem_prBT_mb,
-    double mem_prBP_mb
-) {
-    auto emit = [](std::ofstream& f, const char* name, const PerformanceMetrics& m, double mem){
-        f << "    \"" << name << "\": {\n";
-        f << "      \"buildTime\": " << m.buildTime << ",\n";
-        f << "      \"rangeQuery100\": " << m.rangeQuery100 << ",\n";
-        f << "      \"rangeQuery1000\": " << m.rangeQuery1000 << ",\n";
-        f << "      \"rangeQuery10000\": " << m.rangeQuery10000 << ",\n";
-        f << "      \"exactLookup\": " << m.exactLookup << ",\n";
-        f << "      \"memory\": " << mem << "\n";
+static void writePerfJSON(const std::string& outPath, double buildWall, const std::vector<PerfSection>& sections) {
+    auto emit = [](std::ofstream& f, const PerfEntry& e){
+        f << "    \"" << e.name << "\": {\n";
+        f << "      \"buildTime\": " << e.buildTime << ",\n";
+        if (e.metrics) {
+            f << "      \"rangeQuery100\": " << e.metrics->rangeQuery100 << ",\n";
+            f << "      \"rangeQuery1000\": " << e.metrics->rangeQuery1000 << ",\n";
+            f << "      \"rangeQuery10000\": " << e.metrics->rangeQuery10000 << ",\n";
+            f << "      \"exactLookup\": " << e.metrics->exactLookup << ",\n";
+        }
+        for (const auto& x : e.extra) f << "      \"" << x.first << "\": " << x.second << ",\n";
+        f << "      \"memory\": " << e.memoryMB << "\n";
         f << "    }";
     };
 
     std::ofstream f(outPath, std::ios::trunc);
     f << "{\n";
     f << "  \"updatedAt\": \"" << isoNow() << "\",\n";
-    f << "  \"timestamp_index\": {\n";
-    emit(f, "btree", tsBT, mem_tsBT_mb); f << ",\n";
-    emit(f, "bplustree", tsBP, mem_tsBP_mb); f << "\n";
-    f << "  },\n";
-    f << "  \"price_index\": {\n";
-    emit(f, "btree", prBT, mem_prBT_mb); f << ",\n";
-    emit(f, "bplustree", prBP, mem_prBP_mb); f << "\n";
-    f << "  }\n";
-    f << "}\n";
+    f << "  \"buildWallTime\": " << buildWall;
+    for (const auto& section : sections) {
+        f << ",\n  \"" << section.name << "\": {\n";
+        for (size_t i = 0; i < section.engines.size(); i++) {
+            if (i > 0) f << ",\n";
+            emit(f, section.engines[i]);
+        }
+        f << "\n  }";
+    }
+    f << "\n}\n";
     f.close();
 }
 
 int main() {
-    // Load data
-    auto stocks = loadStockData("stocks.csv", 9999999);
-    auto crypto = loadCryptoData("crypto.csv", 9999999);
+    ThreadPool pool;
+
+    // Load data: reuse the binary snapshot when it matches the CSVs, otherwise parse
+    // (chunks of each file across all cores) and write a fresh snapshot for the next start.
+    // Either way the records' text stays in the mapped file it came from, for the whole run.
+    const std::string snapshotPath = "market.snap";
+    const uint64_t fingerprint = sourceFingerprint({"stocks.csv", "crypto.csv"});
+    SnapshotView snapshot;
+    MappedFile stocksFile, cryptoFile;
+    std::vector<MarketRecord> store; // contiguous, so a record's position doubles as its persisted id
+    const bool fromSnapshot = loadSnapshot(snapshot, snapshotPath, fingerprint, store);
+    if (!fromSnapshot) {
+        stocksFile.open("stocks.csv");
+        cryptoFile.open("crypto.csv");
+        store = loadStockData(stocksFile, 9999999, &pool);
+        auto crypto = loadCryptoData(cryptoFile, 9999999, &pool);
+        store.reserve(store.size() + crypto.size());
+        for (auto& r : crypto) store.push_back(std::move(r));
+        if (!store.empty() && !writeSnapshot(snapshotPath, store, fingerprint)) {
+            std::cerr << "[engine] could not write " << snapshotPath << std::endl;
+        }
+    }
+    // the snapshot holds the rows as parsed, corrections since then are replayed over them
+    CorrectionLog corrections;
+    corrections.replay("market.fixes", fingerprint, store);
 
     std::vector<MarketRecord*> records;
-    records.reserve(stocks.size() + crypto.size());
-    for (auto& r : stocks)  records.push_back(new MarketRecord(r));
-    for (auto& r : crypto)  records.push_back(new MarketRecord(r));
-
-    // Indexes
-    MyBTree     timestampBTree, priceBTree, nameBTree;
-    MyBPlusTree timestampBPlus, priceBPlus, nameBPlus;
-
-    // Build B-Tree
-    auto buildStartBT = std::chrono::high_resolution_clock::now();
-    for (auto* p : records) {
-        timestampBTree.insert(timetoSeconds(p->timestamp), p);
-        priceBTree.insert(priceToInt(p->price), p);
-        uint32_t nk = nameKey32(to_upper(p->name));
-        nameBTree.insert(static_cast<int>(nk), p);
-    }
-    auto buildEndBT = std::chrono::high_resolution_clock::now();
-    const double btreeBuildSec = std::chrono::duration<double>(buildEndBT - buildStartBT).count();
-
-    // Build B+ Tree
-    auto buildStartBP = std::chrono::high_resolution_clock::now();
-    for (auto* p : records) {
-        timestampBPlus.insert(timetoSeconds(p->timestamp), p);
-        priceBPlus.insert(priceToInt(p->price), p);
-        uint32_t nk = nameKey32(to_upper(p->name));
-        nameBPlus.insert(static_cast<int>(nk), p);
-    }
-    auto buildEndBP = std::chrono::high_resolution_clock::now();
-    const double bplusBuildSec = std::chrono::duration<double>(buildEndBP - buildStartBP).count();
+    records.reserve(store.size());
+    for (auto& r : store) records.push_back(&r);
+
+    // Catalog: dense name/symbol ids in first-seen order, so they come out the same on every start
+    // and the persisted name indexes stay valid. The snapshot already lists the distinct names and
+    // symbols in that order, so from it each string is interned once and rows only translate ids.
+    AssetCatalog catalog;
+    if (fromSnapshot) {
+        std::vector<std::string_view> names, symbols;
+        for (uint64_t id = 0; id < snapshot.nameCount(); id++) names.push_back(snapshot.nameAt(id));
+        for (uint64_t id = 0; id < snapshot.symbolCount(); id++) symbols.push_back(snapshot.symbolAt(id));
+        std::vector<uint32_t> nameOf = catalog.names.internAll(names), symbolOf = catalog.symbols.internAll(symbols);
+        for (size_t i = 0; i < store.size(); i++) {
+            store[i].nameId = nameOf[snapshot.nameId(i)];
+            store[i].symbolId = symbolOf[snapshot.symbolId(i)];
+            catalog.linkSymbol(store[i].symbolId, store[i].nameId);
+        }
+    } else {
+        for (auto& r : store) {
+            auto ids = catalog.add(r.name, r.symbol);
+            r.nameId = ids.first;
+            r.symbolId = ids.second;
+        }
+    }
+    std::vector<uint32_t> nameRows;            // name id -> record count, ranks autocomplete hits
+    std::vector<const MarketRecord*> nameFirst; // name id -> a record to show for it
+    for (auto& r : store) {
+        if (r.nameId == nameRows.size()) {
+            nameRows.push_back(0);
+            nameFirst.push_back(&r);
+        }
+        nameRows[r.nameId]++;
+    }
+    // autocomplete: names and symbols both lead to the name's asset
+    PrefixIndex prefixIndex;
+    {
+        std::vector<std::pair<std::string_view, uint32_t>> keys;
+        for (uint32_t id = 0; id < catalog.names.size(); id++) keys.emplace_back(catalog.names.value(id), id);
+        for (uint32_t id = 0; id < catalog.symbols.size(); id++) keys.emplace_back(catalog.symbols.value(id), catalog.symbolName[id]);
+        prefixIndex.build(keys, nameRows);
+    }
 
-    // Tester
-    PerformanceTester tester;
+    // Indexes: the trees are independent, so they are built side by side on the pool. Each one is
+    // reloaded from its own index file when that matches the corrected rows, else bulk loaded and saved.
+    PostingBTree      timestampBTree(store.data()), nameBTree(store.data());
+    PostingBPlusTree  timestampBPlus(store.data()), nameBPlus(store.data());
+    MyBTree           priceBTree;
+    MyBPlusTree       priceBPlus;
+    NameTimeBPlusTree nameTimeBPlus;
+    PriceAggregateTree priceAggregate;
+    LearnedTimestampIndex timestampLearned(store.data());
+    PostingArt        timestampArt(store.data()), priceArt(store.data()), nameArt(store.data());
+
+    // (key, record) entries per key, sorted once by whichever tree needs them first
+    enum IndexKey { TS_KEY, PRICE_KEY, NAME_KEY, KEY_COUNT };
+    const double fillFactor = 1.0; // read-mostly engine, pack nodes full
+    constexpr bool artFor[KEY_COUNT] = {kArtTimestamp, kArtPrice, kArtName};
+    std::vector<std::pair<TreeKey, MarketRecord*>> entries[KEY_COUNT];
+    std::once_flag sortedOnce[KEY_COUNT];
+    auto sortedEntries = [&](IndexKey which) -> const std::vector<std::pair<TreeKey, MarketRecord*>>& {
+        std::call_once(sortedOnce[which], [&] {
+            auto& e = entries[which];
+            e.reserve(records.size());
+            for (auto* p : records) {
+                TreeKey key = which == TS_KEY    ? p->epochMs
+                            : which == PRICE_KEY ? p->priceTicks
+                                                 : static_cast<TreeKey>(p->nameId);
+                e.emplace_back(key, p);
+            }
+            // records live in one vector, so ordering ties by pointer keeps them in load order
+            std::sort(e.begin(), e.end());
+        });
+        return entries[which];
+    };
+    // the composite index has entries of its own, only its task ever needs them
+    auto nameTimeEntries = [&]() {
+        std::vector<std::pair<NameTimeKey, MarketRecord*>> e;
+        e.reserve(records.size());
+        for (auto* p : records) e.emplace_back(NameTimeKey{static_cast<TreeKey>(p->nameId), p->epochMs}, p);
+        std::sort(e.begin(), e.end(), [](const auto& a, const auto& b) { return a.first < b.first || (a.first == b.first && a.second < b.second); });
+        return e;
+    };
+    enum IndexFile { TS_BTREE, PRICE_BTREE, NAME_BTREE, TS_BPLUS, PRICE_BPLUS, NAME_BPLUS, NAMETIME_BPLUS, PRICE_AGG,
+                     TS_LEARNED, TS_ART, PRICE_ART, NAME_ART, INDEX_FILE_COUNT };
+    static const char* const indexPath[INDEX_FILE_COUNT] = {
+        "market.timestamp.btree.idx", "market.price.btree.idx", "market.name.btree.idx",
+        "market.timestamp.bplus.idx", "market.price.bplus.idx", "market.name.bplus.idx",
+        "market.nametime.bplus.idx",  "market.priceagg.bplus.idx", "market.timestamp.learned.idx",
+        "market.timestamp.art.idx",   "market.price.art.idx",   "market.name.art.idx"};
+    // getEntries yields the sorted (key, record) pairs, only called when the index file is unusable
+    auto buildIndex = [&](auto& tree, auto getEntries, IndexFile file) {
+        auto s = std::chrono::high_resolution_clock::now();
+        const std::string path = indexPath[file];
+        if (!loadIndexFile(path, corrections.stamp(), store, tree)) {
+            const auto& e = getEntries();
+            tree.bulkLoad(e.begin(), e.end(), fillFactor);
+            if (!writeIndexFile(path, corrections.stamp(), store, tree)) {
+                std::cerr << "[engine] could not write " << path << std::endl;
+            }
+        }
+        return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - s).count();
+    };
 
-    // Static perf snapshot
-    auto tsBT = tester.testTimestamp(timestampBTree, records);
-    tsBT.buildTime = btreeBuildSec;
-    auto prBT = tester.testPrice(priceBTree, records);
-    prBT.buildTime = btreeBuildSec;
+    IndexBuildTimes build;
+    auto buildStart = std::chrono::high_resolution_clock::now();
+    {
+        auto sorted = [&](IndexKey which) {
+            return [&sortedEntries, which]() -> const std::vector<std::pair<TreeKey, MarketRecord*>>& { return sortedEntries(which); };
+        };
+        auto tsBTDone = pool.submit([&] { return buildIndex(timestampBTree, sorted(TS_KEY),    TS_BTREE); });
+        auto prBTDone = pool.submit([&] { return buildIndex(priceBTree,     sorted(PRICE_KEY), PRICE_BTREE); });
+        auto nmBTDone = pool.submit([&] { return buildIndex(nameBTree,      sorted(NAME_KEY),  NAME_BTREE); });
+        auto tsBPDone = pool.submit([&] { return buildIndex(timestampBPlus, sorted(TS_KEY),    TS_BPLUS); });
+        auto prBPDone = pool.submit([&] { return buildIndex(priceBPlus,     sorted(PRICE_KEY), PRICE_BPLUS); });
+        auto nmBPDone = pool.submit([&] { return buildIndex(nameBPlus,      sorted(NAME_KEY),  NAME_BPLUS); });
+        auto ntBPDone = pool.submit([&] { return buildIndex(nameTimeBPlus,  nameTimeEntries,   NAMETIME_BPLUS); });
+        auto agBPDone = pool.submit([&] { return buildIndex(priceAggregate, sorted(TS_KEY),    PRICE_AGG); });
+        auto tsLIDone = pool.submit([&] { return buildIndex(timestampLearned, sorted(TS_KEY),  TS_LEARNED); });
+        std::future<double> tsARDone, prARDone, nmARDone;
+        if (artFor[TS_KEY])    tsARDone = pool.submit([&] { return buildIndex(timestampArt, sorted(TS_KEY),    TS_ART); });
+        if (artFor[PRICE_KEY]) prARDone = pool.submit([&] { return buildIndex(priceArt,     sorted(PRICE_KEY), PRICE_ART); });
+        if (artFor[NAME_KEY])  nmARDone = pool.submit([&] { return buildIndex(nameArt,      sorted(NAME_KEY),  NAME_ART); });
+        build.timestampBTree = tsBTDone.get();
+        build.priceBTree     = prBTDone.get();
+        build.nameBTree      = nmBTDone.get();
+        build.timestampBPlus = tsBPDone.get();
+        build.priceBPlus     = prBPDone.get();
+        build.nameBPlus      = nmBPDone.get();
+        build.nameTimeBPlus  = ntBPDone.get();
+        build.priceAggregate = agBPDone.get();
+        build.timestampLearned = tsLIDone.get();
+        if (tsARDone.valid()) build.timestampArt = tsARDone.get();
+        if (prARDone.valid()) build.priceArt     = prARDone.get();
+        if (nmARDone.valid()) build.nameArt      = nmARDone.get();
+    }
+    for (auto& e : entries) std::vector<std::pair<TreeKey, MarketRecord*>>().swap(e);
+
+    // Live indexes: loaded in the order the posting trees already hold the rows (no sort), with
+    // room left in every node for the rows the ingest thread adds
+    LiveBPlusTree timestampLive, priceLive;
+    {
+        const double liveFill = 0.75;
+        std::vector<std::pair<TreeKey, MarketRecord*>> e;
+        e.reserve(records.size());
+        auto s = std::chrono::high_resolution_clock::now();
+        for (auto* p : timestampBPlus.rangeQuery(LLONG_MIN, LLONG_MAX)) e.emplace_back(p->epochMs, p);
+        timestampLive.bulkLoad(e.begin(), e.end(), liveFill);
+        auto m = std::chrono::high_resolution_clock::now();
+        e.clear();
+        for (auto* p : priceBPlus.rangeQuery(LLONG_MIN, LLONG_MAX)) e.emplace_back(p->priceTicks, p);
+        priceLive.bulkLoad(e.begin(), e.end(), liveFill);
+        build.timestampLive = std::chrono::duration<double>(m - s).count();
+        build.priceLive = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - m).count();
+    }
+    build.wall = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - buildStart).count();
+
+    // Live ingest: rows appended to live.csv (crypto.csv's columns) while the engine runs. A
+    // background thread picks up every complete line within a poll interval and inserts the rows
+    // into the live trees only; the query loop reads those trees at the same time. Ingested rows are
+    // not in the catalog, the other indexes, the scans or the snapshot. A file that shrinks is
+    // taken as replaced and read again from the start.
+    std::deque<std::string> liveText;  // the lines read so far, which the rows point into
+    std::deque<MarketRecord> liveRows; // grows at the back only, so the trees' pointers stay valid
+    std::atomic<size_t> liveCount{0};
+    std::mutex ingestMutex;
+    std::condition_variable ingestWake;
+    bool stopIngest = false; // guarded by ingestMutex
+    std::thread ingest([&] {
+        const std::string livePath = "live.csv";
+        std::streamoff readUpTo = 0;
+        std::unique_lock<std::mutex> lock(ingestMutex);
+        while (!ingestWake.wait_for(lock, std::chrono::milliseconds(250), [&] { return stopIngest; })) {
+            std::ifstream in(livePath, std::ios::binary | std::ios::ate);
+            if (!in) continue;
+            std::streamoff size = in.tellg();
+            if (size < readUpTo) readUpTo = 0;
+            if (size == readUpTo) continue;
+            std::string chunk(static_cast<size_t>(size - readUpTo), '\0');
+            in.seekg(readUpTo);
+            if (!in.read(chunk.data(), static_cast<std::streamsize>(chunk.size()))) continue;
+            size_t complete = chunk.rfind('\n');
+            if (complete == std::string::npos) continue; // a line still being written
+            chunk.resize(complete + 1);
+            readUpTo += static_cast<std::streamoff>(chunk.size());
+            liveText.push_back(std::move(chunk));
+
+            std::vector<MarketRecord> rows;
+            parseCryptoRows(liveText.back(), INT_MAX, rows); // the header, like any malformed line, is skipped
+            for (auto& r : rows) {
+                r.nameId = r.symbolId = StringCatalog::kNone;
+                liveRows.push_back(r);
+                MarketRecord* p = &liveRows.back();
+                timestampLive.insert(p->epochMs, p);
+                priceLive.insert(p->priceTicks, p);
+            }
+            liveCount += rows.size();
+        }
+    });
 
-    auto tsBP = tester.testTimestamp(timestampBPlus, records);
-    tsBP.buildTime = bplusBuildSec;
-    auto prBP = tester.testPrice(priceBPlus, records);
-    prBP.buildTime = bplusBuildSec;
+    // Tester
+    PerformanceTester tester;
 
+    // Static perf snapshot, rewritten on runPerf
     auto toMB = [](size_t bytes){ return static_cast<double>(bytes) / (1024.0 * 1024.0); };
-    double mem_tsBT_mb = toMB(timestampBTree.approxBytes());
-    double mem_tsBP_mb = toMB(timestampBPlus.approxBytes());
-    double mem_prBT_mb = toMB(priceBTree.approxBytes());
-    double mem_prBP_mb = toMB(priceBPlus.approxBytes());
+    auto writePerf = [&]() {
+        auto timed = [&](const char* name, double buildTime, size_t bytes, const PerformanceMetrics& m) { return PerfEntry(name, buildTime, toMB(bytes), m); };
+        auto untimed = [&](const char* name, double buildTime, size_t bytes) { return PerfEntry(name, buildTime, toMB(bytes)); };
+
+        PerfSection ts{"timestamp_index", {
+            timed("btree",     build.timestampBTree,   timestampBTree.approxBytes(),   tester.testTimestamp(timestampBTree, records)),
+            timed("bplustree", build.timestampBPlus,   timestampBPlus.approxBytes(),   tester.testTimestamp(timestampBPlus, records)),
+            timed("learned",   build.timestampLearned, timestampLearned.approxBytes(), tester.testTimestamp(timestampLearned, records))}};
+        ts.engines.back().extra = {{"segments", static_cast<double>(timestampLearned.segmentCount())},
+                                   {"modelBytes", static_cast<double>(timestampLearned.modelBytes())}};
+        PerfSection pr{"price_index", {
+            timed("btree",     build.priceBTree, priceBTree.approxBytes(), tester.testPrice(priceBTree, records)),
+            timed("bplustree", build.priceBPlus, priceBPlus.approxBytes(), tester.testPrice(priceBPlus, records))}};
+        PerfSection nm{"name_index", {
+            untimed("btree",     build.nameBTree, nameBTree.approxBytes()),
+            untimed("bplustree", build.nameBPlus, nameBPlus.approxBytes())}};
+        if (artFor[TS_KEY])    ts.engines.push_back(timed("art", build.timestampArt, timestampArt.approxBytes(), tester.testTimestamp(timestampArt, records)));
+        if (artFor[PRICE_KEY]) pr.engines.push_back(timed("art", build.priceArt,     priceArt.approxBytes(),     tester.testPrice(priceArt, records)));
+        if (artFor[NAME_KEY])  nm.engines.push_back(untimed("art", build.nameArt,    nameArt.approxBytes()));
+        ts.engines.push_back(timed("live", build.timestampLive, timestampLive.approxBytes(), tester.testTimestamp(timestampLive, records)));
+        pr.engines.push_back(timed("live", build.priceLive,     priceLive.approxBytes(),     tester.testPrice(priceLive, records)));
+
+        std::string perfPath = (std::filesystem::current_path() / "performance_results.json").string();
+        writePerfJSON(perfPath, build.wall, {
+            ts, pr, nm,
+            PerfSection{"name_time_index",       {untimed("bplustree", build.nameTimeBPlus,  nameTimeBPlus.approxBytes())}},
+            PerfSection{"price_aggregate_index", {untimed("bplustree", build.priceAggregate, priceAggregate.approxBytes())}}});
+    };
+    writePerf();
+
+    // Corrections: a row's timestamp and/or price is fixed in place and every index keyed on them
+    // moves the row to its new key; the aggregate tree re-sums just the old and the new timestamp.
+    // The fix is appended to the correction log, then the index files of the trees that changed are
+    // rewritten and the others restamped. A crash in between leaves files at an older stamp, which
+    // the next start rebuilds from the replayed rows. False if some index did not have the row where
+    // it should have been, or the fix could not be logged.
+    auto saveIndex = [&](IndexFile file, uint64_t stamp) {
+        const std::string path = indexPath[file];
+        switch (file) {
+        case TS_BTREE:       return writeIndexFile(path, stamp, store, timestampBTree);
+        case PRICE_BTREE:    return writeIndexFile(path, stamp, store, priceBTree);
+        case NAME_BTREE:     return writeIndexFile(path, stamp, store, nameBTree);
+        case TS_BPLUS:       return writeIndexFile(path, stamp, store, timestampBPlus);
+        case PRICE_BPLUS:    return writeIndexFile(path, stamp, store, priceBPlus);
+        case NAME_BPLUS:     return writeIndexFile(path, stamp, store, nameBPlus);
+        case NAMETIME_BPLUS: return writeIndexFile(path, stamp, store, nameTimeBPlus);
+        case PRICE_AGG:      return writeIndexFile(path, stamp, store, priceAggregate);
+        case TS_LEARNED:     return writeIndexFile(path, stamp, store, timestampLearned);
+        case TS_ART:         return writeIndexFile(path, stamp, store, timestampArt);
+        case PRICE_ART:      return writeIndexFile(path, stamp, store, priceArt);
+        case NAME_ART:       return writeIndexFile(path, stamp, store, nameArt);
+        default:             return false;
+        }
+    };
+    auto correctRecord = [&](MarketRecord* r, int64_t ms, const std::string& timestamp, int64_t ticks, double price) {
+        bool ok = true;
+        const int64_t oldMs = r->epochMs;
+        bool changed[INDEX_FILE_COUNT] = {};
+        if (ms != oldMs) {
+            ok = timestampBTree.update(oldMs, ms, r) && ok;
+            ok = timestampBPlus.update(oldMs, ms, r) && ok;
+            ok = timestampLearned.update(oldMs, ms, r) && ok;
+            if (artFor[TS_KEY]) ok = timestampArt.update(oldMs, ms, r) && ok;
+            TreeKey name = r->nameId;
+            ok = nameTimeBPlus.update(NameTimeKey{name, oldMs}, NameTimeKey{name, ms}, r) && ok;
+            ok = timestampLive.update(oldMs, ms, r) && ok;
+            changed[TS_BTREE] = changed[TS_BPLUS] = changed[TS_LEARNED] = changed[NAMETIME_BPLUS] = changed[PRICE_AGG] = true;
+            changed[TS_ART] = artFor[TS_KEY];
+        }
+        if (ticks != r->priceTicks) {
+            ok = priceBTree.update(r->priceTicks, ticks, r) && ok;
+            ok = priceBPlus.update(r->priceTicks, ticks, r) && ok;
+            if (artFor[PRICE_KEY]) ok = priceArt.update(r->priceTicks, ticks, r) && ok;
+            ok = priceLive.update(r->priceTicks, ticks, r) && ok;
+            changed[PRICE_BTREE] = changed[PRICE_BPLUS] = changed[PRICE_AGG] = true;
+            changed[PRICE_ART] = artFor[PRICE_KEY];
+        }
+        r->epochMs = ms;
+        r->timestamp = corrections.keep(timestamp);
+        r->priceTicks = ticks;
+        r->price = price;
+
+        if (changed[PRICE_AGG]) {
+            PriceTicksOf measure;
+            auto totalAt = [&](int64_t key) {
+                RangeAggregate agg;
+                for (auto* p : timestampBPlus.rangeQuery(key, key)) agg.add(measure(p));
+                return agg;
+            };
+            priceAggregate.assign(oldMs, totalAt(oldMs));
+            if (ms != oldMs) priceAggregate.assign(ms, totalAt(ms));
+        }
 
-    std::string perfPath = (std::filesystem::current_path() / "performance_results.json").string();
-    writePerfJSON(perfPath, tsBT, prBT, tsBP, prBP,
-                  mem_tsBT_mb, mem_tsBP_mb, mem_prBT_mb, mem_prBP_mb);
+        const uint64_t before = corrections.stamp();
+        if (!corrections.append(*r, static_cast<uint64_t>(r - store.data()), fingerprint)) {
+            std::cerr << "[engine] could not log the correction" << std::endl;
+            return false;
+        }
+        for (int f = 0; f < INDEX_FILE_COUNT; f++) {
+            IndexFile file = static_cast<IndexFile>(f);
+            if (!changed[file]) {
+                restampIndexFile(indexPath[file], before, corrections.stamp(), store.size()); // missing when unused
+            } else if (!saveIndex(file, corrections.stamp())) {
+                std::cerr << "[engine] could not write " << indexPath[file] << std::endl;
+            }
+        }
+        return ok;
+    };
 
     // Query loop (stdin JSON -> stdout JSON)
     std::string query_string;
@@ -349,29 +1039,80 @@ int main() {
 
             double btreeQuerySec = 0.0, bplusQuerySec = 0.0, scanQuerySec = 0.0;
             double btreeMemMB = 0.0,  bplusMemMB  = 0.0;
+            double btreeBuildSec = 0.0, bplusBuildSec = 0.0; // of the index this query used
+            json count; // set by "count" queries only
+            json aggregate; // set by "aggregate" queries only
+            json learned; // timestamp queries also time the learned index
+            json art; // ticker, dateRange and priceRange also time the radix engine when it is on
+            json live; // dateRange and priceRange are answered from the live trees, ingested rows included
+            auto liveMetrics = [&](const LiveBPlusTree& tree, double querySec, double buildSec) {
+                json m = json::object();
+                m["querySec"] = querySec;
+                m["buildSec"] = buildSec;
+                m["memoryMB"] = toMB(tree.approxBytes());
+                m["ingestedRows"] = liveCount.load();
+                return m;
+            };
+            auto artMetrics = [&](const PostingArt& index, double querySec, double buildSec) {
+                json m = json::object();
+                m["querySec"] = querySec;
+                m["buildSec"] = buildSec;
+                m["memoryMB"] = toMB(index.approxBytes());
+                return m;
+            };
+            auto learnedMetrics = [&](double querySec) {
+                json m = json::object();
+                m["querySec"] = querySec;
+                m["buildSec"] = build.timestampLearned;
+                m["memoryMB"] = toMB(timestampLearned.approxBytes());
+                m["modelBytes"] = timestampLearned.modelBytes();
+                return m;
+            };
+
+            // paging for the record lists: skip this many matches, then return up to max_results. The
+            // trees stop walking once the page is full, and so does the scan baseline.
+            size_t offset = 0;
+            if (query.contains("offset")) {
+                if (!query["offset"].is_number_integer() || query["offset"].get<int64_t>() < 0) {
+                    json err = json::object(); err["error"] = "offset must be a non-negative integer";
+                    std::cout << err.dump() << std::endl; continue;
+                }
+                offset = static_cast<size_t>(query["offset"].get<int64_t>());
+            }
+            // "order": "desc" reads a range from the top instead (latest ticks, highest prices first)
+            bool descending = query.value("order", std::string("asc")) == "desc";
 
             if (query_type == "ticker") {
                 if (!query.contains("ticker") || !query["ticker"].is_string()) {
                     json err = json::object(); err["error"] = "ticker must be a string";
                     std::cout << err.dump() << std::endl; continue;
                 }
-                std::string q = to_upper(query["ticker"].get<std::string>());
-                int key = static_cast<int>(nameKey32(q));
+                uint32_t nameId = catalog.resolve(query["ticker"].get<std::string>());
+                TreeKey key = nameId; // an unknown name or symbol is kNone, which no record has
 
                 auto qStartBT = std::chrono::high_resolution_clock::now();
-                auto res_bt = nameBTree.rangeQuery(key, key);
+                auto res_bt = nameBTree.rangeQuery(key, key, (size_t)max_results, offset);
                 auto qEndBT = std::chrono::high_resolution_clock::now();
                 btreeQuerySec = std::chrono::duration<double>(qEndBT - qStartBT).count();
 
                 auto qStartBP = std::chrono::high_resolution_clock::now();
-                auto res_bp = nameBPlus.rangeQuery(key, key);
+                auto res_bp = nameBPlus.rangeQuery(key, key, (size_t)max_results, offset);
                 auto qEndBP = std::chrono::high_resolution_clock::now();
                 bplusQuerySec = std::chrono::duration<double>(qEndBP - qStartBP).count();
 
-                scanQuerySec = scanTickerSec(records, q);
+                if (artFor[NAME_KEY]) {
+                    auto qStartAR = std::chrono::high_resolution_clock::now();
+                    auto res_ar = nameArt.rangeQuery(key, key, (size_t)max_results, offset);
+                    auto qEndAR = std::chrono::high_resolution_clock::now();
+                    art = artMetrics(nameArt, std::chrono::duration<double>(qEndAR - qStartAR).count(), build.nameArt);
+                }
+
+                scanQuerySec = scanTickerSec(records, nameId, offset);
 
                 btreeMemMB = toMB(nameBTree.approxBytes());
                 bplusMemMB = toMB(nameBPlus.approxBytes());
+                btreeBuildSec = build.nameBTree;
+                bplusBuildSec = build.nameBPlus;
 
                 const auto& chosen = !res_bt.empty() ? res_bt : res_bp;
                 for (auto* r : chosen) {
@@ -391,25 +1132,52 @@ int main() {
             } else if (query_type == "dateRange") {
                 std::string startDate = query.value("startDate", "");
                 std::string endDate   = query.value("endDate", "");
-                int lo = timetoSeconds(startDate + " 00:00:00");
-                int hi = timetoSeconds(endDate   + " 23:59:59");
+                int64_t lo = timetoMillis(startDate + " 00:00:00");
+                int64_t hi = timetoMillis(endDate   + " 23:59:59.999");
 
                 auto qStartBT = std::chrono::high_resolution_clock::now();
-                auto results_range_bt = timestampBTree.rangeQuery(lo, hi);
+                auto results_range_bt = descending ? timestampBTree.reverseRangeQuery(lo, hi, (size_t)max_results, offset)
+                                                   : timestampBTree.rangeQuery(lo, hi, (size_t)max_results, offset);
                 auto qEndBT = std::chrono::high_resolution_clock::now();
                 btreeQuerySec = std::chrono::duration<double>(qEndBT - qStartBT).count();
 
                 auto qStartBP = std::chrono::high_resolution_clock::now();
-                auto results_range_bp = timestampBPlus.rangeQuery(lo, hi);
+                auto results_range_bp = descending ? timestampBPlus.reverseRangeQuery(lo, hi, (size_t)max_results, offset)
+                                                   : timestampBPlus.rangeQuery(lo, hi, (size_t)max_results, offset);
                 auto qEndBP = std::chrono::high_resolution_clock::now();
                 bplusQuerySec = std::chrono::duration<double>(qEndBP - qStartBP).count();
 
-                scanQuerySec = scanDateRangeSec(records, lo, hi);
+                auto qStartLI = std::chrono::high_resolution_clock::now();
+                auto results_range_li = descending ? timestampLearned.reverseRangeQuery(lo, hi, (size_t)max_results, offset)
+                                                   : timestampLearned.rangeQuery(lo, hi, (size_t)max_results, offset);
+                auto qEndLI = std::chrono::high_resolution_clock::now();
+                learned = learnedMetrics(std::chrono::duration<double>(qEndLI - qStartLI).count());
+
+                if (artFor[TS_KEY]) {
+                    auto qStartAR = std::chrono::high_resolution_clock::now();
+                    auto results_range_ar = descending ? timestampArt.reverseRangeQuery(lo, hi, (size_t)max_results, offset)
+                                                       : timestampArt.rangeQuery(lo, hi, (size_t)max_results, offset);
+                    auto qEndAR = std::chrono::high_resolution_clock::now();
+                    art = artMetrics(timestampArt, std::chrono::duration<double>(qEndAR - qStartAR).count(), build.timestampArt);
+                }
+
+                auto qStartLV = std::chrono::high_resolution_clock::now();
+                auto results_range_lv = descending ? timestampLive.reverseRangeQuery(lo, hi, (size_t)max_results, offset)
+                                                   : timestampLive.rangeQuery(lo, hi, (size_t)max_results, offset);
+                auto qEndLV = std::chrono::high_resolution_clock::now();
+                live = liveMetrics(timestampLive, std::chrono::duration<double>(qEndLV - qStartLV).count(), build.timestampLive);
+
+                scanQuerySec = descending
+                    ? scanLastSec(records, [&](const MarketRecord* p) { return p->epochMs >= lo && p->epochMs <= hi; },
+                                  [](const MarketRecord* p) { return p->epochMs; }, offset)
+                    : scanDateRangeSec(records, lo, hi, offset);
 
                 btreeMemMB = toMB(timestampBTree.approxBytes());
                 bplusMemMB = toMB(timestampBPlus.approxBytes());
+                btreeBuildSec = build.timestampBTree;
+                bplusBuildSec = build.timestampBPlus;
 
-                for (auto result : results_range_bt) {
+                for (auto result : results_range_lv) {
                     if (results.size() >= (size_t)max_results) break;
                     if (!result) continue;
                     json r = json::object();
@@ -426,25 +1194,46 @@ int main() {
             } else if (query_type == "priceRange") {
                 double minPrice = query.value("minPrice", 0.0);
                 double maxPrice = query.value("maxPrice", 0.0);
-                int lo = priceToInt(minPrice);
-                int hi = priceToInt(maxPrice);
+                int64_t lo = priceToInt(minPrice);
+                int64_t hi = priceToInt(maxPrice);
 
                 auto qStartBT = std::chrono::high_resolution_clock::now();
-                auto results_range_bt = priceBTree.rangeQuery(lo, hi);
+                auto results_range_bt = descending ? priceBTree.reverseRangeQuery(lo, hi, (size_t)max_results, offset)
+                                                   : priceBTree.rangeQuery(lo, hi, (size_t)max_results, offset);
                 auto qEndBT = std::chrono::high_resolution_clock::now();
                 btreeQuerySec = std::chrono::duration<double>(qEndBT - qStartBT).count();
 
                 auto qStartBP = std::chrono::high_resolution_clock::now();
-                auto results_range_bp = priceBPlus.rangeQuery(lo, hi);
+                auto results_range_bp = descending ? priceBPlus.reverseRangeQuery(lo, hi, (size_t)max_results, offset)
+                                                   : priceBPlus.rangeQuery(lo, hi, (size_t)max_results, offset);
                 auto qEndBP = std::chrono::high_resolution_clock::now();
                 bplusQuerySec = std::chrono::duration<double>(qEndBP - qStartBP).count();
 
-                scanQuerySec = scanPriceRangeSec(records, lo, hi);
+                if (artFor[PRICE_KEY]) {
+                    auto qStartAR = std::chrono::high_resolution_clock::now();
+                    auto results_range_ar = descending ? priceArt.reverseRangeQuery(lo, hi, (size_t)max_results, offset)
+                                                       : priceArt.rangeQuery(lo, hi, (size_t)max_results, offset);
+                    auto qEndAR = std::chrono::high_resolution_clock::now();
+                    art = artMetrics(priceArt, std::chrono::duration<double>(qEndAR - qStartAR).count(), build.priceArt);
+                }
+
+                auto qStartLV = std::chrono::high_resolution_clock::now();
+                auto results_range_lv = descending ? priceLive.reverseRangeQuery(lo, hi, (size_t)max_results, offset)
+                                                   : priceLive.rangeQuery(lo, hi, (size_t)max_results, offset);
+                auto qEndLV = std::chrono::high_resolution_clock::now();
+                live = liveMetrics(priceLive, std::chrono::duration<double>(qEndLV - qStartLV).count(), build.priceLive);
+
+                scanQuerySec = descending
+                    ? scanLastSec(records, [&](const MarketRecord* p) { return p->priceTicks >= lo && p->priceTicks <= hi; },
+                                  [](const MarketRecord* p) { return p->priceTicks; }, offset)
+                    : scanPriceRangeSec(records, lo, hi, offset);
 
                 btreeMemMB = toMB(priceBTree.approxBytes());
                 bplusMemMB = toMB(priceBPlus.approxBytes());
+                btreeBuildSec = build.priceBTree;
+                bplusBuildSec = build.priceBPlus;
 
-                for (auto result : results_range_bt) {
+                for (auto result : results_range_lv) {
                     if (results.size() >= (size_t)max_results) break;
                     if (!result) continue;
                     json r = json::object();
@@ -458,21 +1247,294 @@ int main() {
                     results.push_back(std::move(r));
                 }
 
+            } else if (query_type == "tickerRange") {
+                // one ticker between two dates, oldest first (newest first with "order": "desc"). The B+ side is a single scan of the
+                // composite index; the B-tree side is how this was answered before it existed: the
+                // name index's rows for the ticker, filtered to the dates and sorted.
+                if (!query.contains("ticker") || !query["ticker"].is_string()) {
+                    json err = json::object(); err["error"] = "ticker must be a string";
+                    std::cout << err.dump() << std::endl; continue;
+                }
+                uint32_t nameId = catalog.resolve(query["ticker"].get<std::string>());
+                TreeKey key = nameId; // an unknown name or symbol is kNone, which no record has
+                int64_t lo = timetoMillis(query.value("startDate", "") + " 00:00:00");
+                int64_t hi = timetoMillis(query.value("endDate", "")   + " 23:59:59.999");
+
+                auto qStartBT = std::chrono::high_resolution_clock::now();
+                std::vector<MarketRecord*> res_bt;
+                for (auto* r : nameBTree.rangeQuery(key, key)) {
+                    if (r->epochMs >= lo && r->epochMs <= hi) res_bt.push_back(r);
+                }
+                std::stable_sort(res_bt.begin(), res_bt.end(), [](const MarketRecord* a, const MarketRecord* b) { return a->epochMs < b->epochMs; });
+                auto qEndBT = std::chrono::high_resolution_clock::now();
+                btreeQuerySec = std::chrono::duration<double>(qEndBT - qStartBT).count();
+
+                auto qStartBP = std::chrono::high_resolution_clock::now();
+                auto res_bp = descending ? nameTimeBPlus.reverseRangeQuery(NameTimeKey{key, lo}, NameTimeKey{key, hi}, (size_t)max_results, offset)
+                                         : nameTimeBPlus.rangeQuery(NameTimeKey{key, lo}, NameTimeKey{key, hi}, (size_t)max_results, offset);
+                auto qEndBP = std::chrono::high_resolution_clock::now();
+                bplusQuerySec = std::chrono::duration<double>(qEndBP - qStartBP).count();
+
+                scanQuerySec = descending
+                    ? scanLastSec(records, [&](const MarketRecord* p) { return p->nameId == nameId && p->epochMs >= lo && p->epochMs <= hi; },
+                                  [](const MarketRecord* p) { return p->epochMs; }, offset)
+                    : scanTickerRangeSec(records, nameId, lo, hi, offset);
+
+                btreeMemMB = toMB(nameBTree.approxBytes());
+                bplusMemMB = toMB(nameTimeBPlus.approxBytes());
+                btreeBuildSec = build.nameBTree;
+                bplusBuildSec = build.nameTimeBPlus;
+
+                for (auto* r : res_bp) {
+                    if (results.size() >= (size_t)max_results) break;
+                    if (!r) continue;
+                    json j = json::object();
+                    j["timestamp"] = r->timestamp;
+                    j["name"]      = r->name;
+                    j["symbol"]    = r->symbol;
+                    j["price"]     = r->price;
+                    j["high"]      = r->high;
+                    j["low"]       = r->low;
+                    j["type"]      = r->type;
+                    results.push_back(std::move(j));
+                }
+
+            } else if (query_type == "count") {
+                // exact size of a ticker, dateRange, priceRange or tickerRange result without reading it:
+                // the posting indexes subtract two group offsets, the pointer trees add up per-child
+                // counts along two root-to-leaf walks
+                std::string of = query.value("of", std::string(""));
+                if ((of == "ticker" || of == "tickerRange") && (!query.contains("ticker") || !query["ticker"].is_string())) {
+                    json err = json::object(); err["error"] = "ticker must be a string";
+                    std::cout << err.dump() << std::endl; continue;
+                }
+                size_t btCount = 0, bpCount = 0, scanCount = 0, lvCount = 0;
+                auto timed = [](auto&& fn) {
+                    auto s = std::chrono::high_resolution_clock::now();
+                    fn();
+                    return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - s).count();
+                };
+                if (of == "ticker") {
+                    uint32_t nameId = catalog.resolve(query["ticker"].get<std::string>());
+                    TreeKey key = nameId;
+                    btreeQuerySec = timed([&] { btCount = nameBTree.countRange(key, key); });
+                    bplusQuerySec = timed([&] { bpCount = nameBPlus.countRange(key, key); });
+                    scanQuerySec = scanCountSec(records, [&](const MarketRecord* p) { return p->nameId == nameId; }, scanCount);
+                    btreeMemMB = toMB(nameBTree.approxBytes());
+                    bplusMemMB = toMB(nameBPlus.approxBytes());
+                    btreeBuildSec = build.nameBTree;
+                    bplusBuildSec = build.nameBPlus;
+                } else if (of == "dateRange") {
+                    int64_t lo = timetoMillis(query.value("startDate", "") + " 00:00:00");
+                    int64_t hi = timetoMillis(query.value("endDate", "")   + " 23:59:59.999");
+                    btreeQuerySec = timed([&] { btCount = timestampBTree.countRange(lo, hi); });
+                    bplusQuerySec = timed([&] { bpCount = timestampBPlus.countRange(lo, hi); });
+                    live = liveMetrics(timestampLive, timed([&] { lvCount = timestampLive.countRange(lo, hi); }), build.timestampLive);
+                    size_t liCount = 0;
+                    learned = learnedMetrics(timed([&] { liCount = timestampLearned.countRange(lo, hi); }));
+                    learned["count"] = liCount;
+                    scanQuerySec = scanCountSec(records, [&](const MarketRecord* p) { return p->epochMs >= lo && p->epochMs <= hi; }, scanCount);
+                    btreeMemMB = toMB(timestampBTree.approxBytes());
+                    bplusMemMB = toMB(timestampBPlus.approxBytes());
+                    btreeBuildSec = build.timestampBTree;
+                    bplusBuildSec = build.timestampBPlus;
+                } else if (of == "priceRange") {
+                    int64_t lo = priceToInt(query.value("minPrice", 0.0));
+                    int64_t hi = priceToInt(query.value("maxPrice", 0.0));
+                    btreeQuerySec = timed([&] { btCount = priceBTree.countRange(lo, hi); });
+                    bplusQuerySec = timed([&] { bpCount = priceBPlus.countRange(lo, hi); });
+                    live = liveMetrics(priceLive, timed([&] { lvCount = priceLive.countRange(lo, hi); }), build.priceLive);
+                    scanQuerySec = scanCountSec(records, [&](const MarketRecord* p) { return p->priceTicks >= lo && p->priceTicks <= hi; }, scanCount);
+                    btreeMemMB = toMB(priceBTree.approxBytes());
+                    bplusMemMB = toMB(priceBPlus.approxBytes());
+                    btreeBuildSec = build.priceBTree;
+                    bplusBuildSec = build.priceBPlus;
+                } else if (of == "tickerRange") {
+                    uint32_t nameId = catalog.resolve(query["ticker"].get<std::string>());
+                    TreeKey key = nameId;
+                    int64_t lo = timetoMillis(query.value("startDate", "") + " 00:00:00");
+                    int64_t hi = timetoMillis(query.value("endDate", "")   + " 23:59:59.999");
+                    // no composite B-tree: its side filters the ticker's rows, as tickerRange does
+                    btreeQuerySec = timed([&] {
+                        auto slice = nameBTree.postings(key, key);
+                        for (const uint32_t* p = slice.first; p != slice.second; ++p) {
+                            int64_t t = store[*p].epochMs;
+                            btCount += t >= lo && t <= hi;
+                        }
+                    });
+                    bplusQuerySec = timed([&] { bpCount = nameTimeBPlus.countRange(NameTimeKey{key, lo}, NameTimeKey{key, hi}); });
+                    scanQuerySec = scanCountSec(records, [&](const MarketRecord* p) { return p->nameId == nameId && p->epochMs >= lo && p->epochMs <= hi; }, scanCount);
+                    btreeMemMB = toMB(nameBTree.approxBytes());
+                    bplusMemMB = toMB(nameTimeBPlus.approxBytes());
+                    btreeBuildSec = build.nameBTree;
+                    bplusBuildSec = build.nameTimeBPlus;
+                } else {
+                    json err = json::object(); err["error"] = "of must be ticker, dateRange, priceRange or tickerRange";
+                    std::cout << err.dump() << std::endl; continue;
+                }
+                count = json::object();
+                count["of"]        = of;
+                count["btree"]     = btCount;
+                count["bplustree"] = bpCount;
+                count["scan"]      = scanCount;
+                if (!live.is_null()) count["live"] = lvCount;
+
+            } else if (query_type == "aggregate") {
+                // min/max/avg/sum of price over a date range. The aggregate tree adds up whole-child
+                // summaries between the two boundary paths; the B-tree side reads the range's rows
+                // and folds them, as the engine had to before.
+                int64_t lo = timetoMillis(query.value("startDate", "") + " 00:00:00");
+                int64_t hi = timetoMillis(query.value("endDate", "")   + " 23:59:59.999");
+                RangeAggregate btAgg, bpAgg, scanAgg;
+                {
+                    auto s = std::chrono::high_resolution_clock::now();
+                    auto slice = timestampBTree.postings(lo, hi);
+                    for (const uint32_t* p = slice.first; p != slice.second; ++p) btAgg.add(store[*p].priceTicks);
+                    btreeQuerySec = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - s).count();
+                }
+                {
+                    auto s = std::chrono::high_resolution_clock::now();
+                    bpAgg = priceAggregate.aggregate(lo, hi);
+                    bplusQuerySec = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - s).count();
+                }
+                scanQuerySec = scanAggregateSec(records, [&](const MarketRecord* p) { return p->epochMs >= lo && p->epochMs <= hi; }, scanAgg);
+                btreeMemMB = toMB(timestampBTree.approxBytes());
+                bplusMemMB = toMB(priceAggregate.approxBytes());
+                btreeBuildSec = build.timestampBTree;
+                bplusBuildSec = build.priceAggregate;
+
+                auto toJson = [](const RangeAggregate& a) {
+                    json j = json::object();
+                    j["count"] = a.count;
+                    if (a.count > 0) { // prices back in dollars
+                        j["min"] = a.min / 100.0;
+                        j["max"] = a.max / 100.0;
+                        j["sum"] = a.sum / 100.0;
+                        j["avg"] = static_cast<double>(a.sum) / a.count / 100.0;
+                    }
+                    return j;
+                };
+                aggregate = json::object();
+                aggregate["btree"]     = toJson(btAgg);
+                aggregate["bplustree"] = toJson(bpAgg);
+                aggregate["scan"]      = toJson(scanAgg);
+
+            } else if (query_type == "correct") {
+                // fixes one row: "ticker" and "timestamp" pick it (the first one at that time), "price"
+                // and/or "newTimestamp" are the corrected values
+                if (!query.contains("ticker") || !query["ticker"].is_string() || !query.contains("timestamp") || !query["timestamp"].is_string()) {
+                    json err = json::object(); err["error"] = "ticker and timestamp must be strings";
+                    std::cout << err.dump() << std::endl; continue;
+                }
+                if (query.contains("price") && (!query["price"].is_number() || !std::isfinite(query["price"].get<double>()))) {
+                    json err = json::object(); err["error"] = "price must be a finite number";
+                    std::cout << err.dump() << std::endl; continue;
+                }
+                if (query.contains("newTimestamp") && (!query["newTimestamp"].is_string() || timetoMillis(query["newTimestamp"].get<std::string>()) == 0)) {
+                    json err = json::object(); err["error"] = "newTimestamp must be a YYYY-MM-DD HH:MM:SS string";
+                    std::cout << err.dump() << std::endl; continue;
+                }
+                TreeKey name = catalog.resolve(query["ticker"].get<std::string>());
+                int64_t ms = timetoMillis(query["timestamp"].get<std::string>());
+                auto row = nameTimeBPlus.rangeQuery(NameTimeKey{name, ms}, NameTimeKey{name, ms}, 1);
+                if (row.empty()) {
+                    json err = json::object(); err["error"] = "no row for that ticker at that time";
+                    std::cout << err.dump() << std::endl; continue;
+                }
+                MarketRecord* r = row[0];
+                std::string timestamp = query.value("newTimestamp", std::string(r->timestamp));
+                double price = query.value("price", r->price);
+                // fields not being corrected keep their parsed values, no round trip through text or double
+                int64_t newMs = query.contains("newTimestamp") ? timetoMillis(timestamp) : r->epochMs;
+                int64_t ticks = query.contains("price") ? priceToInt(price) : r->priceTicks;
+
+                auto qStart = std::chrono::high_resolution_clock::now();
+                bool ok = correctRecord(r, newMs, timestamp, ticks, price);
+                auto qEnd = std::chrono::high_resolution_clock::now();
+
+                json j = json::object();
+                j["timestamp"] = r->timestamp;
+                j["name"]      = r->name;
+                j["symbol"]    = r->symbol;
+                j["price"]     = r->price;
+                j["high"]      = r->high;
+                j["low"]       = r->low;
+                j["type"]      = r->type;
+                results.push_back(std::move(j));
+                json response = json::object();
+                response["queryType"] = query_type;
+                response["results"]   = results;
+                response["ok"]        = ok;
+                response["querySec"]  = std::chrono::duration<double>(qEnd - qStart).count();
+                std::cout << response.dump() << std::endl;
+                continue;
+
+            } else if (query_type == "prefix") {
+                // autocomplete: the most-traded assets whose name or symbol starts with the prefix
+                if (!query.contains("prefix") || !query["prefix"].is_string()) {
+                    json err = json::object(); err["error"] = "prefix must be a string";
+                    std::cout << err.dump() << std::endl; continue;
+                }
+                std::string prefix = query["prefix"].get<std::string>();
+                int limit = std::clamp(query.value("limit", 10), 1, 50);
+
+                auto qStart = std::chrono::high_resolution_clock::now();
+                auto assets = prefixIndex.topK(prefix, static_cast<size_t>(limit));
+                auto qEnd = std::chrono::high_resolution_clock::now();
+
+                for (uint32_t id : assets) {
+                    const MarketRecord* r = nameFirst[id];
+                    json j = json::object();
+                    j["name"]    = r->name;
+                    j["symbol"]  = r->symbol;
+                    j["type"]    = r->type;
+                    j["records"] = nameRows[id];
+                    results.push_back(std::move(j));
+                }
+                json response = json::object();
+                response["queryType"] = query_type;
+                response["results"]   = results;
+                response["querySec"]  = std::chrono::duration<double>(qEnd - qStart).count();
+                std::cout << response.dump() << std::endl;
+                continue;
+
+            } else if (query_type == "sweepFanout") {
+                // B-tree orders: current 5, then nodes sized to 4/8/16 cache lines and a page (same for B+)
+                auto sweep = tester.sweepFanout(records,
+                    std::integer_sequence<int, 5,
+                        btreeOrderForBytes<TreeKey, MarketRecord*>(256), btreeOrderForBytes<TreeKey, MarketRecord*>(512),
+                        btreeOrderForBytes<TreeKey, MarketRecord*>(1024), btreeOrderForBytes<TreeKey, MarketRecord*>(4096)>{},
+                    std::integer_sequence<int, 5,
+                        bplusOrderForBytes<TreeKey, MarketRecord*>(256), bplusOrderForBytes<TreeKey, MarketRecord*>(512),
+                        bplusOrderForBytes<TreeKey, MarketRecord*>(1024), bplusOrderForBytes<TreeKey, MarketRecord*>(4096)>{});
+                json rows = json::array();
+                json best = json::object();
+                std::map<std::string, double> bestCost;
+                for (const auto& r : sweep) {
+                    json j = json::object();
+                    j["tree"]           = r.tree;
+                    j["fanout"]         = r.fanout;
+                    j["nodeBytes"]      = r.nodeBytes;
+                    j["buildSec"]       = r.buildSec;
+                    j["exactLookup"]    = r.exactLookup;
+                    j["rangeQuery1000"] = r.rangeQuery1000;
+                    j["memoryMB"]       = r.memoryMB;
+                    rows.push_back(std::move(j));
+                    double cost = r.exactLookup * 1000 + r.rangeQuery1000; // the sweep's whole query workload
+                    if (!bestCost.count(r.tree) || cost < bestCost[r.tree]) {
+                        bestCost[r.tree] = cost;
+                        best[r.tree] = r.fanout;
+                    }
+                }
+                json response = json::object();
+                response["queryType"] = query_type;
+                response["results"]   = rows;
+                response["best"]      = best;
+                std::cout << response.dump() << std::endl;
+                continue;
+
             } else if (query_type == "runPerf") {
-                auto tsBT2 = tester.testTimestamp(timestampBTree, records);
-                tsBT2.buildTime = btreeBuildSec;
-                auto prBT2 = tester.testPrice(priceBTree, records);
-                prBT2.buildTime = btreeBuildSec;
-
-                auto tsBP2 = tester.testTimestamp(timestampBPlus, records);
-                tsBP2.buildTime = bplusBuildSec;
-                auto prBP2 = tester.testPrice(priceBPlus, records);
-                prBP2.buildTime = bplusBuildSec;
-
-                std::string perfPath2 = (std::filesystem::current_path() / "performance_results.json").string();
-                writePerfJSON(perfPath2, tsBT2, prBT2, tsBP2, prBP2,
-                              toMB(timestampBTree.approxBytes()), toMB(timestampBPlus.approxBytes()),
-                              toMB(priceBTree.approxBytes()),     toMB(priceBPlus.approxBytes()));
+                writePerf();
                 json ok = json::object(); ok["ok"] = true;
                 std::cout << ok.dump() << std::endl;
                 continue;
@@ -482,6 +1544,8 @@ int main() {
             response["results"]   = results;
             response["size"]      = records.size();
             response["queryType"] = query_type;
+            if (!count.is_null()) response["count"] = count;
+            if (!aggregate.is_null()) response["aggregate"] = aggregate;
 
             json metrics = json::object();
             json btree   = json::object();
@@ -500,6 +1564,9 @@ int main() {
             json scan = json::object();
             scan["querySec"] = scanQuerySec;
             metrics["scan"] = scan;
+            if (!learned.is_null()) metrics["learned"] = learned;
+            if (!art.is_null()) metrics["art"] = art;
+            if (!live.is_null()) metrics["live"] = live;
 
             // Live total process memory (RSS/Working Set)
             metrics["rssMB"] = getProcessMemoryMB();
@@ -514,6 +1581,11 @@ int main() {
         }
     }
 
-    for (auto record_ptr : records) delete record_ptr;
+    {
+        std::lock_guard<std::mutex> lock(ingestMutex);
+        stopIngest = true;
+    }
+    ingestWake.notify_one();
+    ingest.join();
     return 0;
 }
\ No newline at end of file
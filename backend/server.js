@@ -75,7 +75,10 @@ app.post('/api/query', async (req, res) => {
         console.error('[api error]', e);
         res.status(500).json({ error: String(e) });
     } finally {
-        kickPerf();
+        // autocomplete fires per keystroke, a count is always followed by its query, and a
+        // correction moves one row, which the perf snapshot would not notice
+        const quiet = ['prefix', 'count', 'correct'];
+        if (!quiet.includes(req.body?.queryType)) kickPerf();
     }
 });
 
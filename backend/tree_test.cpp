@@ -0,0 +1,431 @@
+// Checks for the corrections path: erase/update on both trees at small orders (so every erase
+// borrows, merges or collapses the root somewhere), records moved between keys in the posting
+// indexes and the learned index, and per-key assigns in the aggregate tree, each compared with a
+// fresh bulk load of the same records. The concurrent B+ tree gets the same single-threaded
+// checks, then writers and readers at once (worth a run under -fsanitize=thread too).
+//   g++ -std=c++17 -O1 -pthread -o tree_test tree_test.cpp && ./tree_test
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "BTree.h"
+#include "BPlus.h"
+#include "PostingIndex.h"
+#include "LearnedIndex.h"
+#include "AdaptiveRadixTree.h"
+#include "AggregateBPlus.h"
+#include "ConcurrentBPlus.h"
+
+static int failures = 0;
+#define CHECK(cond) do { if (!(cond)) { failures++; std::cerr << __LINE__ << ": " << #cond << " [" << label << "]" << std::endl; } } while (0)
+
+// --- trees against a multimap of the same (key, value) entries; values start at 1, 0 is "absent" ---
+
+template <typename Tree>
+static void checkTree(Tree& tree, const std::multimap<int64_t, int>& oracle, int64_t lo, int64_t hi, const char* label) {
+    CHECK(tree.size() == oracle.size());
+    for (int64_t k = lo - 1; k <= hi + 1; k++) {
+        auto want = oracle.equal_range(k);
+        std::vector<int> expect;
+        for (auto it = want.first; it != want.second; ++it) expect.push_back(it->second);
+        std::vector<int> got = tree.rangeQuery(k, k), gotRev = tree.reverseRangeQuery(k, k);
+        std::sort(expect.begin(), expect.end());
+        std::sort(got.begin(), got.end());
+        std::sort(gotRev.begin(), gotRev.end());
+        CHECK(got == expect && gotRev == expect);
+        CHECK(tree.countRange(k, k) == expect.size());
+        int found = tree.search(k);
+        CHECK(expect.empty() ? found == 0 : std::binary_search(expect.begin(), expect.end(), found));
+    }
+    std::vector<int> all = tree.rangeQuery(lo - 1, hi + 1), allRev = tree.reverseRangeQuery(lo - 1, hi + 1), expect;
+    for (const auto& e : oracle) expect.push_back(e.second);
+    std::sort(all.begin(), all.end());
+    std::sort(allRev.begin(), allRev.end());
+    std::sort(expect.begin(), expect.end());
+    CHECK(all == expect && allRev == expect);
+}
+
+template <typename Tree>
+static void treeErase(const char* label, bool bulk) {
+    std::mt19937 rng(7);
+    const int64_t lo = 0, hi = 40;
+    Tree tree;
+    std::multimap<int64_t, int> oracle;
+    std::vector<std::pair<int64_t, int>> entries;
+    for (int v = 1; v <= 300; v++) entries.emplace_back(static_cast<int64_t>(rng() % (hi + 1)), v);
+    std::sort(entries.begin(), entries.end());
+    if (bulk) tree.bulkLoad(entries.begin(), entries.end());
+    for (const auto& e : entries) {
+        if (!bulk) tree.insert(e.first, e.second);
+        oracle.emplace(e.first, e.second);
+    }
+    checkTree(tree, oracle, lo, hi, label);
+
+    // every entry out in random order; at these orders that goes through borrows and merges at
+    // every level and ends with the root collapsing down to an empty tree
+    std::shuffle(entries.begin(), entries.end(), rng);
+    for (size_t i = 0; i < entries.size(); i++) {
+        CHECK(tree.erase(entries[i].first, entries[i].second));
+        CHECK(!tree.erase(entries[i].first, entries[i].second));
+        for (auto it = oracle.lower_bound(entries[i].first);; ++it) {
+            if (it->second == entries[i].second) {
+                oracle.erase(it);
+                break;
+            }
+        }
+        if (i % 10 == 0 || oracle.size() < 10) checkTree(tree, oracle, lo, hi, label);
+    }
+    CHECK(tree.size() == 0);
+    CHECK(tree.rangeQuery(LLONG_MIN, LLONG_MAX).empty());
+    tree.insert(5, 1); // usable again after collapsing
+    CHECK(tree.search(5) == 1 && tree.size() == 1);
+}
+
+// one key only: its copies fill whole nodes and separators, so finding a given copy means trying
+// every child that could hold the key
+template <typename Tree>
+static void treeSameKey(const char* label) {
+    std::mt19937 rng(11);
+    Tree tree;
+    std::vector<int> values;
+    for (int v = 1; v <= 200; v++) {
+        tree.insert(7, v);
+        values.push_back(v);
+    }
+    tree.insert(3, 1000);
+    tree.insert(9, 1001);
+    std::shuffle(values.begin(), values.end(), rng);
+    for (size_t i = 0; i < values.size(); i++) {
+        CHECK(tree.erase(7, values[i]));
+        CHECK(!tree.erase(7, values[i]));
+        CHECK(tree.countRange(7, 7) == values.size() - i - 1);
+    }
+    CHECK(tree.search(7) == 0);
+    CHECK(tree.size() == 2 && tree.search(3) == 1000 && tree.search(9) == 1001);
+}
+
+template <typename Tree>
+static void treeUpdate(const char* label) {
+    std::mt19937 rng(13);
+    const int64_t lo = -20, hi = 20;
+    Tree tree;
+    std::multimap<int64_t, int> oracle;
+    std::vector<int64_t> keyOf(201);
+    for (int v = 1; v <= 200; v++) {
+        keyOf[v] = lo + static_cast<int64_t>(rng() % (hi - lo + 1));
+        tree.insert(keyOf[v], v);
+        oracle.emplace(keyOf[v], v);
+    }
+    for (int step = 0; step < 1000; step++) {
+        int v = 1 + static_cast<int>(rng() % 200);
+        int64_t to = lo + static_cast<int64_t>(rng() % (hi - lo + 1));
+        CHECK(!tree.update(keyOf[v] + 100, to, v)); // not filed under that key
+        CHECK(tree.update(keyOf[v], to, v));
+        for (auto it = oracle.lower_bound(keyOf[v]);; ++it) {
+            if (it->second == v) {
+                oracle.erase(it);
+                break;
+            }
+        }
+        oracle.emplace(to, v);
+        keyOf[v] = to;
+        if (step % 50 == 0) checkTree(tree, oracle, lo, hi, label);
+    }
+    checkTree(tree, oracle, lo, hi, label);
+}
+
+// --- key-grouped indexes: after any mix of corrections, answer exactly as a fresh bulk load ---
+
+struct Row {
+    int64_t key;
+    bool filed;
+};
+
+template <typename Index>
+static void sameAnswers(Index& index, Index& fresh, int64_t lo, int64_t hi, std::mt19937& rng, const char* label) {
+    for (int64_t k = lo - 1; k <= hi + 1; k++) {
+        CHECK(index.search(k) == fresh.search(k));
+        CHECK(index.countRange(k, k) == fresh.countRange(k, k));
+    }
+    for (int q = 0; q < 50; q++) {
+        int64_t a = lo - 1 + static_cast<int64_t>(rng() % (hi - lo + 3));
+        int64_t b = lo - 1 + static_cast<int64_t>(rng() % (hi - lo + 3));
+        size_t limit = q % 3 == 0 ? SIZE_MAX : 1 + rng() % 20, offset = q % 4 == 0 ? rng() % 10 : 0;
+        CHECK(index.rangeQuery(a, b, limit, offset) == fresh.rangeQuery(a, b, limit, offset));
+        CHECK(index.reverseRangeQuery(a, b, limit, offset) == fresh.reverseRangeQuery(a, b, limit, offset));
+        CHECK(index.countRange(a, b) == fresh.countRange(a, b));
+    }
+}
+
+template <typename Index>
+static void indexCorrections(const char* label) {
+    std::mt19937 rng(17);
+    const int64_t lo = -30, hi = 30; // signed keys, so the radix tree's byte order is tried too
+    auto randomKey = [&] { return lo + static_cast<int64_t>(rng() % (hi - lo + 1)); };
+    std::vector<Row> rows(400);
+    for (auto& r : rows) r = Row{randomKey(), true};
+    auto entries = [&] {
+        std::vector<std::pair<int64_t, Row*>> e;
+        for (auto& r : rows) {
+            if (r.filed) e.emplace_back(r.key, &r);
+        }
+        std::sort(e.begin(), e.end());
+        return e;
+    };
+    Index index(rows.data());
+    auto e = entries();
+    index.bulkLoad(e.begin(), e.end());
+
+    for (int step = 1; step <= 2000; step++) {
+        Row& r = rows[rng() % rows.size()];
+        int op = static_cast<int>(rng() % 4);
+        if (!r.filed) { // back in under some key, maybe one whose group emptied earlier
+            r.key = randomKey();
+            index.insert(r.key, &r);
+            r.filed = true;
+        } else if (op == 0) {
+            CHECK(index.erase(r.key, &r));
+            CHECK(!index.erase(r.key, &r));
+            r.filed = false;
+        } else {
+            int64_t to = randomKey();
+            CHECK(!index.erase(r.key == hi ? lo : r.key + 1, &r)); // filed under r.key only
+            CHECK(index.update(r.key, to, &r));
+            r.key = to;
+        }
+        if (step % 100 == 0) {
+            Index fresh(rows.data());
+            auto now = entries();
+            fresh.bulkLoad(now.begin(), now.end());
+            sameAnswers(index, fresh, lo, hi, rng, label);
+        }
+    }
+    // empty it completely, then fill it again
+    for (auto& r : rows) {
+        if (r.filed) CHECK(index.erase(r.key, &r));
+        r.filed = false;
+    }
+    CHECK(index.countRange(LLONG_MIN, LLONG_MAX) == 0);
+    for (auto& r : rows) {
+        r.key = randomKey();
+        index.insert(r.key, &r);
+        r.filed = true;
+    }
+    Index fresh(rows.data());
+    auto now = entries();
+    fresh.bulkLoad(now.begin(), now.end());
+    sameAnswers(index, fresh, lo, hi, rng, label);
+}
+
+// --- aggregate tree: a key's aggregate replaced in place, splits included ---
+
+struct Tick {
+    int64_t key;
+    int64_t value;
+};
+struct TickValue {
+    int64_t operator()(const Tick* t) const { return t->value; }
+};
+
+static bool sameAggregate(const RangeAggregate& a, const RangeAggregate& b) {
+    return a.count == b.count && (a.count == 0 || (a.sum == b.sum && a.min == b.min && a.max == b.max));
+}
+
+template <typename Tree>
+static void aggregateAssign(const char* label, bool startEmpty) {
+    std::mt19937 rng(19);
+    const int64_t lo = 0, hi = 300;
+    std::vector<Tick> ticks(500);
+    for (auto& t : ticks) t = Tick{static_cast<int64_t>(rng() % 100) * 3, static_cast<int64_t>(rng() % 1000) - 500};
+    auto keyAggregate = [&](int64_t key) {
+        RangeAggregate a;
+        for (const auto& t : ticks) {
+            if (t.key == key) a.add(t.value);
+        }
+        return a;
+    };
+    auto bulk = [&](Tree& tree) {
+        std::vector<std::pair<int64_t, Tick*>> e;
+        for (auto& t : ticks) e.emplace_back(t.key, &t);
+        std::sort(e.begin(), e.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+        tree.bulkLoad(e.begin(), e.end());
+    };
+    Tree tree;
+    if (startEmpty) { // every key arrives through assign, so the tree grows by splits alone
+        std::vector<int64_t> keys;
+        for (const auto& t : ticks) keys.push_back(t.key);
+        std::shuffle(keys.begin(), keys.end(), rng);
+        for (int64_t k : keys) tree.assign(k, keyAggregate(k));
+    } else {
+        bulk(tree);
+    }
+    for (int step = 1; step <= 1500; step++) {
+        Tick& t = ticks[rng() % ticks.size()];
+        int64_t from = t.key;
+        if (rng() % 2) t.key = static_cast<int64_t>(rng() % (hi + 1)); // often a key the tree lacks
+        t.value = static_cast<int64_t>(rng() % 1000) - 500;
+        tree.assign(from, keyAggregate(from));
+        if (t.key != from) tree.assign(t.key, keyAggregate(t.key));
+        if (step % 100 == 0) {
+            Tree fresh;
+            bulk(fresh);
+            for (int q = 0; q < 100; q++) {
+                int64_t a = lo - 1 + static_cast<int64_t>(rng() % (hi - lo + 3));
+                int64_t b = a + static_cast<int64_t>(rng() % 60);
+                CHECK(sameAggregate(tree.aggregate(a, b), fresh.aggregate(a, b)));
+            }
+            CHECK(sameAggregate(tree.total(), fresh.total()));
+        }
+    }
+}
+
+// --- concurrent B+ tree: inserts, erases and updates racing with readers ---
+
+// a value's key is derived from the value, so readers can check every entry they get back
+static int64_t keyOf(int64_t v) { return (v * 7919) % 500; }
+
+template <typename Tree>
+static void concurrentReadWrite(const char* label) {
+    const int writers = 4, readers = 4;
+    const int64_t stable = 3000, perWriter = 20000; // values below stable are bulk loaded and never touched
+    // written values: a third are erased again, a fifth of the rest moved to the key of value + 1
+    auto erased = [&](int64_t v) { return v >= stable && v % 3 == 0; };
+    auto moved = [&](int64_t v) { return v >= stable && v % 3 != 0 && v % 5 == 0; };
+    auto keyFits = [&](int64_t k, int64_t v) { return k == keyOf(v) || (moved(v) && k == keyOf(v + 1)); };
+
+    Tree tree;
+    std::vector<std::pair<int64_t, int64_t>> base;
+    for (int64_t v = 0; v < stable; v++) base.emplace_back(keyOf(v), v);
+    std::sort(base.begin(), base.end());
+    tree.bulkLoad(base.begin(), base.end(), 0.7);
+    std::vector<size_t> stableBelow(502, 0); // stable entries with key < k
+    for (const auto& e : base) stableBelow[e.first + 1]++;
+    for (size_t k = 1; k < stableBelow.size(); k++) stableBelow[k] += stableBelow[k - 1];
+    auto stableIn = [&](int64_t a, int64_t b) {
+        return stableBelow[std::clamp<int64_t>(b + 1, 0, 501)] - stableBelow[std::clamp<int64_t>(a, 0, 501)];
+    };
+
+    std::atomic<int> running{writers};
+    std::atomic<int> threadFailures{0};
+    std::vector<std::thread> threads;
+    for (int w = 0; w < writers; w++) {
+        threads.emplace_back([&, w] {
+            std::mt19937 rng(100 + w);
+            std::vector<int64_t> mine;
+            for (int64_t i = 0; i < perWriter; i++) mine.push_back(stable + w * perWriter + i);
+            std::shuffle(mine.begin(), mine.end(), rng);
+            int bad = 0;
+            for (int64_t v : mine) tree.insert(keyOf(v), v);
+            for (int64_t v : mine) {
+                if (erased(v)) {
+                    bad += !tree.erase(keyOf(v), v) || tree.erase(keyOf(v), v);
+                } else if (moved(v)) {
+                    bad += !tree.update(keyOf(v), keyOf(v + 1), v);
+                }
+            }
+            threadFailures += bad;
+            running--;
+        });
+    }
+    for (int r = 0; r < readers; r++) {
+        threads.emplace_back([&, r] {
+            std::mt19937 rng(200 + r);
+            int bad = 0;
+            do {
+                int64_t a = static_cast<int64_t>(rng() % 520) - 10, b = a + static_cast<int64_t>(rng() % 80);
+                // in range, in key order, each value once; stable entries never move, so a read of
+                // the whole range has every one of them
+                std::vector<int64_t> values;
+                int64_t last = LLONG_MIN;
+                size_t stableSeen = 0;
+                for (auto c = tree.cursor(a, b); c.valid(); c.next()) {
+                    bad += c.key() < a || c.key() > b || c.key() < last || !keyFits(c.key(), c.value());
+                    last = c.key();
+                    values.push_back(c.value());
+                    stableSeen += c.value() < stable;
+                }
+                bad += stableSeen != stableIn(a, b);
+                last = LLONG_MAX;
+                stableSeen = 0;
+                for (auto c = tree.reverseCursor(a, b); c.valid(); c.next()) {
+                    bad += c.key() < a || c.key() > b || c.key() > last || !keyFits(c.key(), c.value());
+                    last = c.key();
+                    stableSeen += c.value() < stable;
+                }
+                bad += stableSeen != stableIn(a, b);
+                std::sort(values.begin(), values.end());
+                bad += std::adjacent_find(values.begin(), values.end()) != values.end();
+                bad += tree.countRange(a, b) < stableIn(a, b);
+                size_t limit = 1 + rng() % 50, offset = rng() % 20;
+                bad += tree.rangeQuery(a, b, limit, offset).size() > limit;
+                int64_t k = static_cast<int64_t>(rng() % 500);
+                int64_t found = tree.search(k);
+                bad += stableIn(k, k) > 0 && !keyFits(k, found);
+            } while (running.load() > 0);
+            threadFailures += bad;
+        });
+    }
+    for (auto& t : threads) t.join();
+    CHECK(threadFailures.load() == 0);
+
+    // settled: the same answers as a plain B+ tree over what should be left
+    std::vector<std::pair<int64_t, int64_t>> all = base;
+    for (int64_t v = stable; v < stable + writers * perWriter; v++) {
+        if (!erased(v)) all.emplace_back(moved(v) ? keyOf(v + 1) : keyOf(v), v);
+    }
+    std::sort(all.begin(), all.end());
+    BasicBPlus<int64_t, int64_t, 8> plain;
+    plain.bulkLoad(all.begin(), all.end());
+    CHECK(tree.size() == all.size());
+    std::mt19937 rng(300);
+    for (int q = 0; q < 300; q++) {
+        int64_t a = static_cast<int64_t>(rng() % 520) - 10, b = a + static_cast<int64_t>(rng() % 80);
+        size_t limit = q % 3 == 0 ? SIZE_MAX : 1 + rng() % 40, offset = q % 4 == 0 ? rng() % 30 : 0;
+        auto sorted = [](std::vector<int64_t> values) { // copies of a key can come in another order
+            std::sort(values.begin(), values.end());
+            return values;
+        };
+        std::vector<int64_t> want = sorted(plain.rangeQuery(a, b));
+        CHECK(sorted(tree.rangeQuery(a, b)) == want);
+        CHECK(sorted(tree.reverseRangeQuery(a, b)) == want);
+        CHECK(tree.rangeQuery(a, b, limit, offset).size() == plain.rangeQuery(a, b, limit, offset).size());
+        CHECK(tree.countRange(a, b) == plain.countRange(a, b));
+    }
+}
+
+int main() {
+    treeErase<BasicBTree<int64_t, int, 2>>("btree order 2, inserted", false);
+    treeErase<BasicBTree<int64_t, int, 2>>("btree order 2, bulk loaded", true);
+    treeErase<BasicBTree<int64_t, int, 3>>("btree order 3, bulk loaded", true);
+    treeErase<BasicBPlus<int64_t, int, 4>>("b+ tree order 4, inserted", false);
+    treeErase<BasicBPlus<int64_t, int, 4>>("b+ tree order 4, bulk loaded", true);
+    treeErase<BasicBPlus<int64_t, int, 5>>("b+ tree order 5, inserted", false);
+    treeSameKey<BasicBTree<int64_t, int, 2>>("btree order 2, one key");
+    treeSameKey<BasicBPlus<int64_t, int, 4>>("b+ tree order 4, one key");
+    treeSameKey<BasicBPlus<int64_t, int, 5>>("b+ tree order 5, one key");
+    treeUpdate<BasicBTree<int64_t, int, 2>>("btree order 2, update");
+    treeUpdate<BasicBPlus<int64_t, int, 4>>("b+ tree order 4, update");
+    treeErase<ConcurrentBPlus<int64_t, int, 4>>("concurrent b+ tree order 4, inserted", false);
+    treeErase<ConcurrentBPlus<int64_t, int, 4>>("concurrent b+ tree order 4, bulk loaded", true);
+    treeSameKey<ConcurrentBPlus<int64_t, int, 4>>("concurrent b+ tree order 4, one key");
+    treeUpdate<ConcurrentBPlus<int64_t, int, 4>>("concurrent b+ tree order 4, update");
+    concurrentReadWrite<ConcurrentBPlus<int64_t, int64_t, 4>>("concurrent b+ tree order 4, threads");
+    concurrentReadWrite<ConcurrentBPlus<int64_t, int64_t, 16>>("concurrent b+ tree order 16, threads");
+
+    indexCorrections<PostingIndex<BasicBTree<int64_t, PostingRange, 2>, Row>>("posting btree order 2");
+    indexCorrections<PostingIndex<BasicBPlus<int64_t, PostingRange, 4>, Row>>("posting b+ tree order 4");
+    indexCorrections<PostingIndex<AdaptiveRadixTree<int64_t, PostingRange>, Row>>("posting radix tree");
+    indexCorrections<LearnedIndex<int64_t, Row, 2>>("learned index, epsilon 2");
+    aggregateAssign<AggregateBPlus<int64_t, Tick, TickValue, 3>>("aggregate order 3, bulk loaded", false);
+    aggregateAssign<AggregateBPlus<int64_t, Tick, TickValue, 3>>("aggregate order 3, from empty", true);
+    aggregateAssign<AggregateBPlus<int64_t, Tick, TickValue, 5>>("aggregate order 5, bulk loaded", false);
+
+    if (failures == 0) std::cout << "all tree checks passed" << std::endl;
+    return failures == 0 ? 0 : 1;
+}
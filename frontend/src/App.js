@@ -1,4 +1,4 @@
-import React, { useState, useEffect } from 'react';
+import React, { useState, useEffect, useRef } from 'react';
 import {
     LineChart, Line, BarChart, Bar, XAxis, YAxis,
     CartesianGrid, Tooltip, Legend, ResponsiveContainer, ReferenceLine, Brush
@@ -26,13 +26,16 @@ function AppInner() {
     const [tickerInput, setTickerInput] = useState('');
     const [startDate, setStartDate] = useState('2024-01-15');
     const [endDate, setEndDate] = useState('2024-01-17');
+    const [latestFirst, setLatestFirst] = useState(false);
     const [minPrice, setMinPrice] = useState('');
     const [maxPrice, setMaxPrice] = useState('');
     const [results, setResults] = useState([]);
+    const [matchCount, setMatchCount] = useState(null); // full size of the result, rows may be a page of it
     const [isLoading, setIsLoading] = useState(false);
     const [performanceMetrics, setPerformanceMetrics] = useState(null);
     const [perfData, setPerfData] = useState(null);
     const [totalRecords, setTotalRecords] = useState(null);
+    const [suggestions, setSuggestions] = useState([]);
 
     // fetch perf snapshot
     const loadPerf = async () => {
@@ -56,9 +59,48 @@ function AppInner() {
     };
     useEffect(() => { loadPerf(); }, []);
 
+    // autocomplete for the name box. The engine answers one request at a time and turns away the
+    // rest, so typing is debounced, nothing is asked while a query runs, and an answer for text the
+    // box no longer holds is dropped.
+    const suggestTimer = useRef(null);
+    const suggestInFlight = useRef(null); // the suggestion request the engine is answering, if any
+    const queryRunning = useRef(false);
+    const latestInput = useRef('');
+    useEffect(() => () => clearTimeout(suggestTimer.current), []);
+
+    const fetchSuggestions = async (text) => {
+        if (queryRunning.current) return;
+        const req = (async () => {
+            try {
+                const r = await fetch(`http://127.0.0.1:8080/api/query?ts=${Date.now()}`, {
+                    method: 'POST',
+                    headers: { 'Content-Type': 'application/json' },
+                    body: JSON.stringify({ queryType: 'prefix', prefix: text, limit: 8 })
+                });
+                const data = await r.json();
+                if (latestInput.current === text) setSuggestions(Array.isArray(data.results) ? data.results : []);
+            } catch (e) {
+                console.log('Suggest error:', e.message); // keep the last suggestions
+            }
+        })();
+        suggestInFlight.current = req;
+        await req;
+        if (suggestInFlight.current === req) suggestInFlight.current = null;
+    };
+    const suggest = (text) => {
+        latestInput.current = text;
+        clearTimeout(suggestTimer.current);
+        if (!text.trim()) { setSuggestions([]); return; }
+        suggestTimer.current = setTimeout(() => fetchSuggestions(text), 120);
+    };
+
     // run query
     const runQuery = async () => {
         setIsLoading(true);
+        // no suggestion may be waiting on the engine while the count and the query go out
+        queryRunning.current = true;
+        clearTimeout(suggestTimer.current);
+        if (suggestInFlight.current) await suggestInFlight.current;
 
         const query = {};
         if (queryType === 'ticker') {
@@ -68,12 +110,32 @@ function AppInner() {
             query.queryType = 'dateRange';
             query.startDate = startDate;
             query.endDate = endDate;
+            if (latestFirst) query.order = 'desc';
+        } else if (queryType === 'tickerRange') {
+            query.queryType = 'tickerRange';
+            query.ticker = tickerInput;
+            query.startDate = startDate;
+            query.endDate = endDate;
+            if (latestFirst) query.order = 'desc';
         } else if (queryType === 'priceRange') {
             query.queryType = 'priceRange';
             query.minPrice = minPrice === '' ? undefined : parseFloat(minPrice);
             query.maxPrice = maxPrice === '' ? undefined : parseFloat(maxPrice);
         }
 
+        // total first: the engine takes one request at a time and the query kicks off a perf run
+        try {
+            const c = await fetch(`http://127.0.0.1:8080/api/query?ts=${Date.now()}`, {
+                method: 'POST',
+                headers: { 'Content-Type': 'application/json' },
+                body: JSON.stringify({ ...query, queryType: 'count', of: query.queryType })
+            });
+            const counted = await c.json();
+            setMatchCount(counted?.count?.bplustree ?? null);
+        } catch (e) {
+            setMatchCount(null);
+        }
+
         const t0 = performance.now();
         try {
             const res = await fetch(`http://127.0.0.1:8080/api/query?ts=${Date.now()}`, {
@@ -147,6 +209,7 @@ function AppInner() {
         } catch (err) {
             console.log('Query error:', err);
         } finally {
+            queryRunning.current = false;
             setIsLoading(false);
         }
     };
@@ -155,7 +218,7 @@ function AppInner() {
     const getChartData = () => {
         if (results.length === 0) return { type: 'none', data: [] };
 
-        if (queryType === 'ticker') {
+        if (queryType === 'ticker' || queryType === 'tickerRange') {
             const validResults = results
                 .filter(r => r.price && !isNaN(r.price) && r.price > 0)
                 .sort((a, b) => String(a.timestamp).localeCompare(String(b.timestamp)));
@@ -262,24 +325,33 @@ function AppInner() {
                                     >
                                         <option value="ticker">By Name/Symbol</option>
                                         <option value="dateRange">By Date Range</option>
+                                        <option value="tickerRange">By Name/Symbol and Date Range</option>
                                         <option value="priceRange">By Price Range</option>
                                     </select>
                                 </div>
 
-                                {queryType === 'ticker' && (
+                                {(queryType === 'ticker' || queryType === 'tickerRange') && (
                                     <div>
                                         <label className="block text-gray-300 mb-2 text-sm font-medium">Name or Symbol</label>
                                         <input
                                             type="text"
                                             value={tickerInput}
-                                            onChange={(e) => setTickerInput(e.target.value)}
+                                            onChange={(e) => { setTickerInput(e.target.value); suggest(e.target.value); }}
+                                            list="asset-suggestions"
                                             placeholder="Microsoft, Bitcoin, Apple..."
                                             className="w-full bg-black text-white border border-yellow-500/50 rounded-lg p-2 text-sm focus:outline-none focus:border-yellow-500"
                                         />
+                                        <datalist id="asset-suggestions">
+                                            {suggestions.map(a => (
+                                                <option key={a.name} value={a.name}>
+                                                    {a.symbol ? `${a.symbol} · ${a.records} rows` : `${a.records} rows`}
+                                                </option>
+                                            ))}
+                                        </datalist>
                                     </div>
                                 )}
 
-                                {queryType === 'dateRange' && (
+                                {(queryType === 'dateRange' || queryType === 'tickerRange') && (
                                     <>
                                         <div>
                                             <label className="block text-gray-300 mb-2 text-sm font-medium">Start Date</label>
@@ -299,6 +371,14 @@ function AppInner() {
                                                 className="w-full bg-black text-white border border-yellow-500/50 rounded-lg p-2 text-sm focus:outline-none focus:border-yellow-500"
                                             />
                                         </div>
+                                        <label className="flex items-center gap-2 text-gray-300 text-sm">
+                                            <input
+                                                type="checkbox"
+                                                checked={latestFirst}
+                                                onChange={(e) => setLatestFirst(e.target.checked)}
+                                            />
+                                            Latest first
+                                        </label>
                                     </>
                                 )}
 
@@ -340,7 +420,7 @@ function AppInner() {
                     <div className="lg:col-span-3 space-y-6">
                         {results.length > 0 && (
                             <div className="bg-zinc-900 rounded-lg shadow-lg p-6 border border-yellow-500/30">
-                                <h2 className="text-lg font-bold text-yellow-400 mb-4">Query Results ({results.length} records)</h2>
+                                <h2 className="text-lg font-bold text-yellow-400 mb-4">Query Results ({matchCount != null && matchCount > results.length ? `${results.length} of ${matchCount}` : results.length} records)</h2>
                                 <div className="overflow-x-auto max-h-96 overflow-y-auto">
                                     <table className="w-full text-sm">
                                         <thead className="sticky top-0 bg-black">